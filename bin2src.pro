@@ -5,6 +5,10 @@ CONFIG += console
 CONFIG -= app_bundle
 CONFIG -= qt
 
+# Threads for overlapped read/format/write (define BIN2SRC_NO_THREADS to disable)
+unix: QMAKE_CFLAGS += -pthread
+unix: LIBS += -pthread
+
 # ----------------------------------------------------------
 # Add 'parg' library
 INCLUDEPATH += $$PWD/third_party/parg/
@@ -12,5 +16,11 @@ HEADERS += $$PWD/third_party/parg/parg.h
 SOURCES += $$PWD/third_party/parg/parg.c
 # ----------------------------------------------------------
 
+# ----------------------------------------------------------
+# Conversion engine (also built as a library by 'libbin2src.pro')
+HEADERS += $$PWD/sources/bin2src.h
+# ----------------------------------------------------------
+
 SOURCES += \
-    $$PWD/sources/main.c
+    $$PWD/sources/main.c \
+    $$PWD/sources/bin2src.c
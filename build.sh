@@ -16,6 +16,28 @@ unzip ./third_party/parg-master.zip -d ./third_party/
 # Rename 'parg-master' into 'parg'
 mv ./third_party/parg-master/ ./third_party/parg/
 
+# --------------------------------------------------------------------
+# Compile library: static 'libbin2src.a' and shared 'libbin2src.so'
+# (public API is in 'sources/bin2src.h')
+
+gcc \
+    -O3 \
+    \
+    -Wall -Wextra -Werror \
+    -std=c89 -ansi -pedantic -pedantic-errors \
+    -pthread \
+    -fPIC \
+    \
+    -c ./sources/bin2src.c \
+    \
+    -o bin2src.o || exit 1
+
+ar rcs libbin2src.a bin2src.o || exit 1
+
+gcc -shared -pthread bin2src.o -o libbin2src.so || exit 1
+
+rm -f bin2src.o
+
 # --------------------------------------------------------------------
 # Compile executable
 
@@ -24,12 +46,15 @@ gcc \
     \
     -Wall -Wextra -Werror \
     -std=c89 -ansi -pedantic -pedantic-errors \
+    -pthread \
     \
     -I ./third_party/parg/ \
     \
     ./sources/main.c \
     ./third_party/parg/parg.c \
     \
+    libbin2src.a \
+    \
     -o bin2src
 
 # --------------------------------------------------------------------
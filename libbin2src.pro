@@ -0,0 +1,16 @@
+# QMake project file of 'libbin2src' - the conversion engine as a library
+
+TEMPLATE = lib
+TARGET = bin2src
+CONFIG -= qt
+CONFIG += staticlib # Remove for a shared library
+
+# Threads for overlapped read/format/write (define BIN2SRC_NO_THREADS to disable)
+unix: QMAKE_CFLAGS += -pthread
+unix: LIBS += -pthread
+
+HEADERS += \
+    $$PWD/sources/bin2src.h
+
+SOURCES += \
+    $$PWD/sources/bin2src.c
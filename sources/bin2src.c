@@ -0,0 +1,4155 @@
+#if defined(__unix__) || defined(__APPLE__)
+    /* Must be defined before any system header, since we build with '-ansi' */
+    #define _POSIX_C_SOURCE 200112L
+    #define BIN2SRC_POSIX
+#endif
+
+#if defined(BIN2SRC_POSIX) && !defined(BIN2SRC_NO_THREADS)
+    #define BIN2SRC_THREADS /* Overlapped read/format/write, see write_input_bytes() */
+#endif
+
+#include "bin2src.h"
+
+#include <stdlib.h> /* malloc(), realloc(), free() */
+#include <stdio.h>  /* fprintf(), fopen(), fclose(), vsnprintf() */
+#include <string.h> /* strlen(), strcmp(), strcat(), etc */
+#include <stdarg.h> /* va_list for sink_printf() */
+#include <time.h>   /* clock(), clock_gettime() */
+
+#if defined(BIN2SRC_POSIX)
+    #include <sys/types.h>   /* ssize_t */
+    #include <unistd.h>      /* write() for bin2src_sink_fd() */
+    #include <errno.h>       /* errno, EINTR */
+#elif defined(_WIN32)
+    #include <io.h>          /* _write() for bin2src_sink_fd() */
+    #include <windows.h>     /* InitOnceExecuteOnce() */
+#endif
+
+#if defined(_WIN32)
+    #define BIN2SRC_VSNPRINTF _vsnprintf /* Returns -1, if the buffer is too small */
+#else
+    #define BIN2SRC_VSNPRINTF vsnprintf  /* C99 and POSIX */
+#endif
+
+#if defined(BIN2SRC_THREADS)
+    #include <pthread.h>     /* pthread_create(), pthread_mutex_lock(), etc */
+#endif
+
+/*
+    Portability notes:
+      - In 'fprintf()' instead of '%zu' (for 'size_t' type) used '%lu' with
+        '(unsigned long)' cast - since '%zu' was added in 'C99', but for
+        portability we also supports 'C89', which dont know about '%zu'.
+        - Reference: https://stackoverflow.com/a/2930710/
+*/
+
+/* -------------------------------------------------------------------------- */
+
+static int is_digit(char ch)
+{
+    return (ch >= '0' && ch <= '9');
+}
+
+static int is_alphabet(char ch)
+{
+    return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'));
+}
+
+/*
+    Returns 0 on success, 1 on failure.
+
+    The rules for naming variables:
+    - Variable names in C++ can range from 1 to 255 characters.
+    - All variable names must begin with a letter of the alphabet or an underscore(_).
+    - After the first initial letter, variable names can also contain letters and numbers.
+    - Variable names are case sensitive.
+    - No spaces or special characters are allowed.
+    - You cannot use a C++ keyword (a reserved word) as a variable name.
+
+    Notice 1) for simplicity, this function NOT ALLOW non-ascii characters.
+    Notice 2) for simplicity, this function DONT CHECK C++ keywords.
+*/
+int bin2src_check_var_name(const char* str, size_t str_len)
+{
+    size_t i = 0;
+
+    /* Empty name - not allowed */
+    if(str_len == 0)  return 1;
+
+    /* Too long name - not allowed */
+    if(str_len > 255) return 1;
+
+    /* First character is digit - not allowed */
+    if(is_digit(str[0])) return 1;
+
+    /* Allow only digits, alphabet characters, underscore */
+    for(; i < str_len; ++i)
+    {
+        const char ch = str[i];
+
+        if (!is_digit(ch) && !is_alphabet(ch) && !(ch == '_'))
+        {
+            return 1;
+        }
+    }
+
+    /* Everything ok */
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Opens the (non-empty) file for reading, and gets its size.
+    Return: 0 on success, non-0 on error.
+    Attention: you must close the file manually
+*/
+static int open_input_file(const char* filename, FILE** out_file, size_t* out_file_size)
+{
+    FILE* f_input = NULL;
+    size_t file_size = 0;
+
+    f_input = fopen(filename, "rb");
+    if(f_input == NULL)
+    {
+        fprintf(stderr, "Error: can\'t open file %s\n", filename);
+        return 1;
+    }
+
+    /* Get the file length */
+    fseek(f_input, 0, SEEK_END);
+    file_size = ftell(f_input);
+    fseek(f_input, 0, SEEK_SET);
+
+    if(file_size == 0)
+    {
+        fprintf(stderr, "Error: file %s is empty\n", filename);
+
+        fclose(f_input);
+        return 1;;
+    }
+
+    *out_file      = f_input;
+    *out_file_size = file_size;
+    return 0;
+}
+
+/* See bin2src.h */
+int bin2src_read_file(const char* filename, char** buffer, size_t* buffer_capacity, size_t* out_file_size)
+{
+    FILE* f_input = NULL;
+    size_t file_size = 0;
+    size_t num_bytes_read = 0;
+
+    if(open_input_file(filename, &f_input, &file_size) != 0)
+    {
+        return 1;
+    }
+
+    if(*buffer == NULL || *buffer_capacity < file_size)
+    {
+        char* new_buffer = (char*) realloc(*buffer, file_size);
+        if(new_buffer == NULL)
+        {
+            fprintf(stderr, "Error: cannot alocate memory (%lu bytes) to store file\'s %s content\n", (unsigned long)file_size, filename);
+
+            fclose(f_input);
+            return 1;
+        }
+
+        *buffer          = new_buffer;
+        *buffer_capacity = file_size;
+    }
+
+    num_bytes_read = fread(*buffer, 1, file_size, f_input);
+    if(num_bytes_read != file_size)
+    {
+        fprintf(stderr, "Error: cannot read the whole file %s. (read bytes: %lu != content bytes %lu)\n", filename, (unsigned long)num_bytes_read, (unsigned long)file_size);
+
+        fclose(f_input);
+        return 1;
+    }
+
+    /* Successful read */
+    fclose(f_input);
+    *out_file_size = file_size;
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    CRC32C (Castagnoli, reflected polynomial 0x82F63B78) of the input,
+    computed at generation time and emitted next to '<name>_size'.
+
+    Implemented as 'slicing-by-8': eight 256-entry tables let us consume
+    8 input bytes per iteration. SSE4.2/ARMv8 crc32 instructions are not
+    used, since they are not reachable from strict C89.
+
+    Notice: 'unsigned long' is at least 32 bits wide, so results are
+    always masked with 0xFFFFFFFF (it may be wider, e.g. on LP64).
+*/
+
+#define CRC32C_POLY 0x82F63B78UL
+
+static unsigned long crc32c_table[8][256];
+
+static void crc32c_fill_table(void)
+{
+    unsigned long i = 0;
+    size_t k = 0;
+
+    for(; i < 256; ++i)
+    {
+        unsigned long crc = i;
+        int bit = 0;
+        for(; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0UL - (crc & 1UL)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+
+    for(i = 0; i < 256; ++i)
+    {
+        for(k = 1; k < 8; ++k)
+        {
+            const unsigned long prev = crc32c_table[k - 1][i];
+            crc32c_table[k][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+        }
+    }
+}
+
+/*
+    Tables are filled once, on first use. Concurrent conversions may get
+    here at the same time, so it's guarded by pthread_once() (or its Win32
+    counterpart). Without either, bin2src_crc32c() must be called once
+    before conversions are started from several threads.
+*/
+#if defined(BIN2SRC_THREADS)
+
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init_table(void)
+{
+    pthread_once(&crc32c_table_once, crc32c_fill_table);
+}
+
+#elif defined(_WIN32)
+
+static INIT_ONCE crc32c_table_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK crc32c_fill_table_once(PINIT_ONCE once, PVOID parameter, PVOID* context)
+{
+    (void)once; (void)parameter; (void)context;
+    crc32c_fill_table();
+    return TRUE;
+}
+
+static void crc32c_init_table(void)
+{
+    InitOnceExecuteOnce(&crc32c_table_once, crc32c_fill_table_once, NULL, NULL);
+}
+
+#else
+
+static int crc32c_table_ready = 0;
+
+static void crc32c_init_table(void)
+{
+    if(crc32c_table_ready) return;
+
+    crc32c_fill_table();
+    crc32c_table_ready = 1;
+}
+
+#endif
+
+/*
+    Continues the checksum 'crc' (use CRC32C_INIT for the first chunk) over
+    the next chunk of bytes. Pass the final value through crc32c_final().
+*/
+#define CRC32C_INIT 0xFFFFFFFFUL
+
+static unsigned long crc32c_update(unsigned long crc, const char* bytes, size_t bytes_count)
+{
+    const unsigned char* p = (const unsigned char*) bytes;
+
+    crc32c_init_table();
+
+    while(bytes_count >= 8)
+    {
+        crc ^=  (unsigned long)p[0]
+            | ((unsigned long)p[1] <<  8)
+            | ((unsigned long)p[2] << 16)
+            | ((unsigned long)p[3] << 24);
+
+        crc = crc32c_table[7][ crc        & 0xff]
+            ^ crc32c_table[6][(crc >>  8) & 0xff]
+            ^ crc32c_table[5][(crc >> 16) & 0xff]
+            ^ crc32c_table[4][(crc >> 24) & 0xff]
+            ^ crc32c_table[3][p[4]]
+            ^ crc32c_table[2][p[5]]
+            ^ crc32c_table[1][p[6]]
+            ^ crc32c_table[0][p[7]];
+
+        p += 8;
+        bytes_count -= 8;
+    }
+
+    while(bytes_count > 0)
+    {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p) & 0xff];
+        ++p;
+        --bytes_count;
+    }
+
+    return crc;
+}
+
+static unsigned long crc32c_final(unsigned long crc)
+{
+    return (crc ^ 0xFFFFFFFFUL) & 0xFFFFFFFFUL;
+}
+
+static unsigned long crc32c(const char* bytes, size_t bytes_count)
+{
+    return crc32c_final(crc32c_update(CRC32C_INIT, bytes, bytes_count));
+}
+
+unsigned long bin2src_crc32c(const char* bytes, size_t bytes_count)
+{
+    return crc32c(bytes, bytes_count);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Output sinks: all generated code goes through 'sink->write', so the
+    same writers produce files, memory buffers, or anything else. The first
+    failed write sets 'sink->error' and later writes are skipped, so
+    writers check it only once, at the end.
+*/
+
+/* Returns 0 on success, non-0 on error (now or earlier) */
+static int sink_write(bin2src_sink* sink, const char* data, size_t size)
+{
+    if(!sink->error && size > 0 && sink->write(sink, data, size) != 0)
+    {
+        sink->error = 1;
+    }
+    return sink->error;
+}
+
+/* fprintf() into the sink. Formats into the stack buffer (or heap, for long output) */
+static void sink_printf(bin2src_sink* sink, const char* format, ...)
+{
+    char    stack_buffer[1024];
+    char*   buffer      = stack_buffer;
+    size_t  buffer_size = sizeof(stack_buffer);
+    int     length      = 0;
+    va_list args;
+
+    for(;;)
+    {
+        va_start(args, format);
+        length = BIN2SRC_VSNPRINTF(buffer, buffer_size, format, args);
+        va_end(args);
+
+        if(length >= 0 && (size_t)length < buffer_size) break;
+
+        /* Too small buffer: grow to the needed length (or twice, if it's unknown) */
+        if(buffer != stack_buffer) free(buffer);
+
+        buffer_size = (length >= 0) ? (size_t)length + 1 : buffer_size * 2;
+        buffer = (char*) malloc(buffer_size);
+        if(buffer == NULL)
+        {
+            sink->error = 1;
+            return;
+        }
+    }
+
+    sink_write(sink, buffer, (size_t)length);
+
+    if(buffer != stack_buffer) free(buffer);
+}
+
+static int write_to_file(bin2src_sink* sink, const char* data, size_t size)
+{
+    return (fwrite(data, 1, size, (FILE*) sink->context) == size) ? 0 : 1;
+}
+
+static int write_to_fd(bin2src_sink* sink, const char* data, size_t size)
+{
+#if defined(BIN2SRC_POSIX)
+    while(size > 0)
+    {
+        const ssize_t written = write(sink->fd, data, size);
+        if(written < 0)
+        {
+            if(errno == EINTR) continue;
+            return 1;
+        }
+
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+#elif defined(_WIN32)
+    while(size > 0)
+    {
+        const unsigned int part = (size > 0x40000000UL) ? 0x40000000U : (unsigned int)size;
+        const int written = _write(sink->fd, data, part);
+        if(written <= 0) return 1;
+
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+#else
+    (void)sink;
+    (void)data;
+    (void)size;
+    fprintf(stderr, "Error: file descriptors are not supported on this platform\n");
+    return 1;
+#endif
+}
+
+static int write_to_buffer(bin2src_sink* sink, const char* data, size_t size)
+{
+    bin2src_buffer* buffer = (bin2src_buffer*) sink->context;
+
+    if(buffer->capacity - buffer->size < size)
+    {
+        size_t new_capacity = (buffer->capacity > 0) ? buffer->capacity : 4096;
+        char*  new_data     = NULL;
+
+        while(new_capacity - buffer->size < size) new_capacity *= 2;
+
+        new_data = (char*) realloc(buffer->data, new_capacity);
+        if(new_data == NULL)
+        {
+            fprintf(stderr, "Error: cannot alocate memory (%lu bytes) for the output buffer\n", (unsigned long)new_capacity);
+            return 1;
+        }
+
+        buffer->data     = new_data;
+        buffer->capacity = new_capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return 0;
+}
+
+void bin2src_sink_callback(bin2src_sink* sink, bin2src_write_func write_func, void* context)
+{
+    sink->write   = write_func;
+    sink->context = context;
+    sink->fd      = -1;
+    sink->error   = 0;
+}
+
+void bin2src_sink_file(bin2src_sink* sink, FILE* file)
+{
+    bin2src_sink_callback(sink, write_to_file, file);
+}
+
+void bin2src_sink_fd(bin2src_sink* sink, int fd)
+{
+    bin2src_sink_callback(sink, write_to_fd, NULL);
+    sink->fd = fd;
+}
+
+void bin2src_sink_buffer(bin2src_sink* sink, bin2src_buffer* buffer)
+{
+    bin2src_sink_callback(sink, write_to_buffer, buffer);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Bytes emitter: writes the input as "0x00, 0x01, ..." (11 bytes per line)
+    and computes its CRC32C on the way.
+
+    Input flows through 3 stages, in chunks of PIPELINE_CHUNK_SIZE bytes:
+
+      - read   - from the input file or callback (or a slice of in-memory input)
+      - format - CRC32C update and formatting (table-driven, no printf)
+      - write  - into the output sink
+
+    With BIN2SRC_THREADS the read and write stages run in their own threads,
+    connected to the format stage by queues of PIPELINE_DEPTH chunks
+    (triple-buffering), so disk reads, formatting and disk writes overlap.
+    Otherwise (or if a thread cannot be started) the stages run one after
+    another for each chunk. Either way, memory use is bounded by a few
+    chunks, not by the input size.
+*/
+
+#define PIPELINE_CHUNK_SIZE (256 * 1024) /* Multiple of any '--word-size' */
+#define PIPELINE_DEPTH      3
+
+/* Upper bound of formatted chunk size: "0xNN, " per byte, plus "\n\t" per line */
+#define PIPELINE_FORMATTED_SIZE(bytes_count) ((bytes_count) * 6 + ((bytes_count) / 11 + 1) * 2)
+
+/* Monotonic time in milliseconds, for statistics */
+static double now_ms(void)
+{
+#if defined(BIN2SRC_POSIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#else
+    return (double)clock() * 1000.0 / (double)CLOCKS_PER_SEC;
+#endif
+}
+
+/*
+    How array elements are emitted ('--word-size', '--endian'): each element
+    packs 'word_size' input bytes, so the compiler parses 'word_size' times
+    fewer initializers. The last element is padded with zero bytes.
+
+    Compact format ('--compact') drops spaces, tabs and leading zeros, emits
+    bytes in decimal (words stay hex), and fills lines up to
+    'max_line_length' characters.
+*/
+typedef struct {
+    size_t word_size;       /* 1 (bytes), 2, 4 or 8 */
+    int    big_endian;      /* Byte order of the target */
+    int    compact;
+    size_t max_line_length; /* Of compact lines */
+} ElementFormat;
+
+/* Input of the writers */
+typedef struct {
+    const char*       file_name; /* For error messages */
+    const char*       bytes;     /* Whole input in memory, NULL - stream via 'read' */
+    bin2src_read_func read;
+    void*             context;
+    size_t            size;
+    bin2src_stats*    stats;     /* NULL - don't collect */
+} InputData;
+
+typedef struct {
+    char*       buffer; /* Owned storage (NULL for slices of in-memory input) */
+    const char* data;   /* Payload */
+    size_t      size;   /* 0 - end of stream */
+    int         error;  /* Read error (input chunks), or write error (output chunks) */
+    int         stop;   /* Set on a free input chunk: the format stage stopped early */
+} Chunk;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/*
+    Formats 'bytes', that are at [first_index, first_index + bytes_count)
+    in the whole array. Returns number of written characters.
+    Fast path of format_elements() for 'word_size' 1.
+*/
+static size_t format_bytes(char* out, const char* bytes, size_t bytes_count, size_t first_index)
+{
+    char* p = out;
+    size_t column = first_index % 11;
+    size_t i = 0;
+
+    for(; i < bytes_count; ++i)
+    {
+        const unsigned int byte = (unsigned int)(bytes[i] & 0xff);
+
+        if(first_index + i != 0) {
+            p[0] = ',';
+            p[1] = ' ';
+            p += 2;
+        }
+
+        if(column == 0) {
+            p[0] = '\n';
+            p[1] = '\t';
+            p += 2;
+        }
+        if(++column == 11) column = 0;
+
+        p[0] = '0';
+        p[1] = 'x';
+        p[2] = HEX_DIGITS[byte >> 4];
+        p[3] = HEX_DIGITS[byte & 0xf];
+        p += 4;
+    }
+
+    return (size_t)(p - out);
+}
+
+/*
+    Compact variant of format_bytes(): decimal bytes, without padding and
+    spaces, 'per_line' bytes per line. Takes about 3.6 characters per byte
+    of random data, instead of 6.2.
+*/
+static size_t format_bytes_compact(char* out, const char* bytes, size_t bytes_count, size_t first_index,
+                                   size_t per_line)
+{
+    char* p = out;
+    size_t column = first_index % per_line;
+    size_t i = 0;
+
+    for(; i < bytes_count; ++i)
+    {
+        unsigned int byte = (unsigned int)(bytes[i] & 0xff);
+
+        if(first_index + i != 0) *p++ = ',';
+
+        if(column == 0) *p++ = '\n';
+        if(++column == per_line) column = 0;
+
+        if(byte >= 100) {
+            *p++ = (char)('0' + byte / 100);
+            byte %= 100;
+            *p++ = (char)('0' + byte / 10);
+        }
+        else if(byte >= 10) {
+            *p++ = (char)('0' + byte / 10);
+        }
+        *p++ = (char)('0' + byte % 10);
+    }
+
+    return (size_t)(p - out);
+}
+
+/* Elements per line: keeps lines about as long as in bytes mode, or up to the limit in compact format */
+static size_t elements_per_line(const ElementFormat* format)
+{
+    if(format->compact)
+    {
+        /* Widest elements: "255," or "0x" + all digits + "," (shorter ones leave the line shorter) */
+        const size_t width    = (format->word_size == 1) ? 4 : 3 + format->word_size * 2;
+        const size_t per_line = format->max_line_length / width;
+
+        return (per_line > 0) ? per_line : 1;
+    }
+
+    switch(format->word_size) {
+    case 2:  return 8;
+    case 4:  return 6;
+    case 8:  return 4;
+    default: return 11;
+    }
+}
+
+/*
+    Formats 'bytes', that are at [first_index, first_index + bytes_count)
+    in the whole array, as elements of 'format->word_size' bytes.
+    'first_index' must be a multiple of the word size, and 'bytes_count'
+    too, except for the last call (its tail is padded with zeros).
+    Returns number of written characters.
+*/
+static size_t format_elements(char* out, const char* bytes, size_t bytes_count, size_t first_index,
+                              const ElementFormat* format)
+{
+    const size_t word_size = format->word_size;
+    const size_t per_line  = elements_per_line(format);
+
+    char* p = out;
+    size_t element = first_index / word_size;
+    size_t column  = element % per_line;
+    size_t i = 0;
+    int leading = 0; /* Leading zeros of the element are being skipped */
+
+    if(word_size == 1)
+    {
+        return format->compact ? format_bytes_compact(out, bytes, bytes_count, first_index, per_line)
+                               : format_bytes(out, bytes, bytes_count, first_index);
+    }
+
+    for(; i < bytes_count; i += word_size, ++element)
+    {
+        size_t k = 0;
+
+        if(element != 0) {
+            *p++ = ',';
+            if(!format->compact) *p++ = ' ';
+        }
+
+        if(column == 0) {
+            *p++ = '\n';
+            if(!format->compact) *p++ = '\t';
+        }
+        if(++column == per_line) column = 0;
+
+        p[0] = '0';
+        p[1] = 'x';
+        p += 2;
+
+        /* Most significant byte first. Compact: without leading zeros, but at least "0x0" */
+        for(leading = format->compact; k < word_size; ++k)
+        {
+            const size_t byte_index = format->big_endian ? k : (word_size - 1 - k);
+            const unsigned int byte = (i + byte_index < bytes_count) ? (unsigned int)(bytes[i + byte_index] & 0xff) : 0;
+
+            if(leading && byte == 0 && k + 1 < word_size) continue;
+
+            if(!leading || byte > 0xf) *p++ = HEX_DIGITS[byte >> 4];
+            *p++ = HEX_DIGITS[byte & 0xf];
+            leading = 0;
+        }
+    }
+
+    return (size_t)(p - out);
+}
+
+/* Reads the next 'size' bytes of streamed input. Returns 0 on success, non-0 on error */
+static int read_exactly(const InputData* input, char* buffer, size_t size)
+{
+    while(size > 0)
+    {
+        const size_t bytes_read = input->read(input->context, buffer, size);
+        if(bytes_read == 0) return 1;
+
+        buffer += bytes_read;
+        size   -= bytes_read;
+    }
+    return 0;
+}
+
+/* Read stage: fills 'chunk' with input bytes at 'offset' */
+static void pipeline_read(const InputData* input, size_t offset, Chunk* chunk)
+{
+    const size_t remaining = input->size - offset;
+
+    chunk->size  = (remaining < PIPELINE_CHUNK_SIZE) ? remaining : PIPELINE_CHUNK_SIZE;
+    chunk->data  = chunk->buffer;
+    chunk->error = 0;
+
+    if(input->bytes != NULL)
+    {
+        chunk->data = input->bytes + offset;
+    }
+    else if(chunk->size > 0)
+    {
+        if(read_exactly(input, chunk->buffer, chunk->size) != 0)
+        {
+            fprintf(stderr, "Error: cannot read the whole file %s (was it changed during conversion?)\n", input->file_name);
+            chunk->error = 1;
+        }
+    }
+}
+
+/* Reference implementation, also used for small inputs and as a fallback */
+static int write_input_bytes_serial(bin2src_sink* sink, const InputData* input, const ElementFormat* format,
+                                    unsigned long* out_checksum)
+{
+    Chunk in;
+    Chunk out;
+    unsigned long crc = CRC32C_INIT;
+    size_t offset = 0;
+    int result = 0;
+    double started_at = now_ms();
+    double t = 0.0;
+
+    in.buffer  = NULL;
+    out.buffer = (char*) malloc(PIPELINE_FORMATTED_SIZE(PIPELINE_CHUNK_SIZE));
+    if(input->bytes == NULL)
+    {
+        in.buffer = (char*) malloc(PIPELINE_CHUNK_SIZE);
+    }
+
+    if(out.buffer == NULL || (input->bytes == NULL && in.buffer == NULL))
+    {
+        fprintf(stderr, "Error: cannot allocate memory for output formatting\n");
+
+        free(in.buffer);
+        free(out.buffer);
+        return 1;
+    }
+
+    while(offset < input->size)
+    {
+        t = now_ms();
+        pipeline_read(input, offset, &in);
+        if(input->stats != NULL) input->stats->read_ms += now_ms() - t;
+
+        if(in.error)
+        {
+            result = 1;
+            break;
+        }
+
+        t = now_ms();
+        crc = crc32c_update(crc, in.data, in.size);
+        out.size = format_elements(out.buffer, in.data, in.size, offset, format);
+        if(input->stats != NULL) input->stats->format_ms += now_ms() - t;
+
+        t = now_ms();
+        if(sink_write(sink, out.buffer, out.size) != 0)
+        {
+            result = 1;
+            break;
+        }
+        if(input->stats != NULL)
+        {
+            input->stats->write_ms  += now_ms() - t;
+            input->stats->bytes_out += (unsigned long)out.size;
+        }
+
+        offset += in.size;
+    }
+
+    if(input->stats != NULL)
+    {
+        input->stats->bytes_in += (unsigned long)offset;
+        input->stats->wall_ms  += now_ms() - started_at;
+    }
+
+    free(in.buffer);
+    free(out.buffer);
+
+    *out_checksum = crc32c_final(crc);
+    return result;
+}
+
+#if defined(BIN2SRC_THREADS)
+
+/* Blocking queue of chunks, up to PIPELINE_DEPTH */
+typedef struct {
+    Chunk*          items[PIPELINE_DEPTH];
+    size_t          head;
+    size_t          count;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+} ChunkQueue;
+
+static void chunk_queue_init(ChunkQueue* queue)
+{
+    queue->head  = 0;
+    queue->count = 0;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+}
+
+static void chunk_queue_destroy(ChunkQueue* queue)
+{
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->cond);
+}
+
+static void chunk_queue_push(ChunkQueue* queue, Chunk* chunk)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->count == PIPELINE_DEPTH)
+    {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    queue->items[(queue->head + queue->count) % PIPELINE_DEPTH] = chunk;
+    ++queue->count;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static Chunk* chunk_queue_pop(ChunkQueue* queue)
+{
+    Chunk* chunk = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->count == 0)
+    {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    chunk = queue->items[queue->head];
+    queue->head = (queue->head + 1) % PIPELINE_DEPTH;
+    --queue->count;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+
+    return chunk;
+}
+
+typedef struct {
+    const InputData*     input;
+    const ElementFormat* format;
+    bin2src_sink*        output;
+
+    ChunkQueue free_in;   /* Read stage takes empty input chunks from here */
+    ChunkQueue full_in;   /* ... and passes them to the format stage */
+    ChunkQueue free_out;  /* Format stage takes empty output chunks from here */
+    ChunkQueue full_out;  /* ... and passes them to the write stage */
+
+    double read_ms;
+    double write_ms;
+    int    write_error;
+} Pipeline;
+
+static void* pipeline_reader_thread(void* arg)
+{
+    Pipeline* pipeline = (Pipeline*) arg;
+    size_t offset = 0;
+
+    for(;;)
+    {
+        Chunk* chunk = chunk_queue_pop(&pipeline->free_in);
+        double t = 0.0;
+
+        if(chunk->stop)
+        {
+            chunk->size = 0; /* Acknowledges the end */
+            chunk_queue_push(&pipeline->full_in, chunk);
+            break;
+        }
+
+        t = now_ms();
+        pipeline_read(pipeline->input, offset, chunk);
+        pipeline->read_ms += now_ms() - t;
+
+        chunk_queue_push(&pipeline->full_in, chunk);
+
+        if(chunk->size == 0 || chunk->error) break;
+        offset += chunk->size;
+    }
+
+    return NULL;
+}
+
+static void* pipeline_writer_thread(void* arg)
+{
+    Pipeline* pipeline = (Pipeline*) arg;
+
+    for(;;)
+    {
+        Chunk* chunk = chunk_queue_pop(&pipeline->full_out);
+        double t = 0.0;
+
+        if(chunk->size == 0) break;
+
+        t = now_ms();
+        if(!pipeline->write_error && sink_write(pipeline->output, chunk->data, chunk->size) != 0)
+        {
+            pipeline->write_error = 1; /* Keep draining, so the format stage never blocks */
+        }
+        pipeline->write_ms += now_ms() - t;
+
+        chunk->error = pipeline->write_error; /* Tells the format stage to stop */
+
+        chunk_queue_push(&pipeline->free_out, chunk);
+    }
+
+    return NULL;
+}
+
+/* Returns 0 on success, non-0 on error, -1 if threads cannot be used */
+static int write_input_bytes_threaded(bin2src_sink* sink, const InputData* input, const ElementFormat* format,
+                                      unsigned long* out_checksum)
+{
+    Pipeline pipeline;
+    Chunk in_chunks[PIPELINE_DEPTH];
+    Chunk out_chunks[PIPELINE_DEPTH];
+    pthread_t reader;
+    pthread_t writer;
+
+    unsigned long crc = CRC32C_INIT;
+    size_t offset = 0;
+    double format_ms = 0.0;
+    double started_at = now_ms();
+    int result = 0;
+    size_t i = 0;
+
+    /* Allocate chunks */
+    for(i = 0; i < PIPELINE_DEPTH; ++i)
+    {
+        in_chunks[i].buffer  = (input->bytes == NULL) ? (char*) malloc(PIPELINE_CHUNK_SIZE) : NULL;
+        out_chunks[i].buffer = (char*) malloc(PIPELINE_FORMATTED_SIZE(PIPELINE_CHUNK_SIZE));
+        out_chunks[i].data   = out_chunks[i].buffer;
+
+        in_chunks[i].error  = 0;
+        in_chunks[i].stop   = 0;
+        out_chunks[i].error = 0;
+        out_chunks[i].stop  = 0;
+
+        if( (input->bytes == NULL && in_chunks[i].buffer == NULL) || out_chunks[i].buffer == NULL ) result = -1;
+    }
+
+    if(result == 0)
+    {
+        pipeline.input       = input;
+        pipeline.format      = format;
+        pipeline.output      = sink;
+        pipeline.read_ms     = 0.0;
+        pipeline.write_ms    = 0.0;
+        pipeline.write_error = 0;
+
+        chunk_queue_init(&pipeline.free_in);
+        chunk_queue_init(&pipeline.full_in);
+        chunk_queue_init(&pipeline.free_out);
+        chunk_queue_init(&pipeline.full_out);
+
+        for(i = 0; i < PIPELINE_DEPTH; ++i)
+        {
+            chunk_queue_push(&pipeline.free_in,  &in_chunks[i]);
+            chunk_queue_push(&pipeline.free_out, &out_chunks[i]);
+        }
+
+        /* Writer first: if the reader cannot start, nothing is consumed yet */
+        if(pthread_create(&writer, NULL, pipeline_writer_thread, &pipeline) != 0)
+        {
+            result = -1;
+        }
+        else if(pthread_create(&reader, NULL, pipeline_reader_thread, &pipeline) != 0)
+        {
+            Chunk* out = chunk_queue_pop(&pipeline.free_out);
+            out->size = 0; /* Stops the writer */
+            chunk_queue_push(&pipeline.full_out, out);
+
+            pthread_join(writer, NULL);
+            result = -1;
+        }
+
+        if(result == 0)
+        {
+            /* Format stage */
+            for(;;)
+            {
+                Chunk* in  = chunk_queue_pop(&pipeline.full_in);
+                Chunk* out = chunk_queue_pop(&pipeline.free_out);
+                double t = 0.0;
+
+                if(out->error && in->size != 0 && !in->error)
+                {
+                    /* Writing failed: stop the reader, skip what it has read already */
+                    in->stop = 1;
+                    chunk_queue_push(&pipeline.free_in, in);
+
+                    for(in = chunk_queue_pop(&pipeline.full_in); in->size != 0 && !in->error; in = chunk_queue_pop(&pipeline.full_in))
+                    {
+                        chunk_queue_push(&pipeline.free_in, in);
+                    }
+                }
+
+                if(in->size == 0 || in->error)
+                {
+                    if(in->error) result = 1;
+
+                    out->size = 0; /* Stops the writer */
+                    chunk_queue_push(&pipeline.full_out, out);
+                    break;
+                }
+
+                t = now_ms();
+                crc = crc32c_update(crc, in->data, in->size);
+                out->size = format_elements(out->buffer, in->data, in->size, offset, format);
+                format_ms += now_ms() - t;
+
+                offset += in->size;
+
+                if(input->stats != NULL) input->stats->bytes_out += (unsigned long)out->size;
+
+                chunk_queue_push(&pipeline.free_in, in);
+                chunk_queue_push(&pipeline.full_out, out);
+            }
+
+            pthread_join(reader, NULL);
+            pthread_join(writer, NULL);
+
+            if(pipeline.write_error) result = 1;
+
+            if(input->stats != NULL)
+            {
+                input->stats->read_ms   += pipeline.read_ms;
+                input->stats->format_ms += format_ms;
+                input->stats->write_ms  += pipeline.write_ms;
+                input->stats->bytes_in  += (unsigned long)offset;
+                input->stats->wall_ms   += now_ms() - started_at;
+            }
+        }
+
+        chunk_queue_destroy(&pipeline.free_in);
+        chunk_queue_destroy(&pipeline.full_in);
+        chunk_queue_destroy(&pipeline.free_out);
+        chunk_queue_destroy(&pipeline.full_out);
+    }
+
+    for(i = 0; i < PIPELINE_DEPTH; ++i)
+    {
+        free(in_chunks[i].buffer);
+        free(out_chunks[i].buffer);
+    }
+
+    *out_checksum = crc32c_final(crc);
+    return result;
+}
+
+#endif /* BIN2SRC_THREADS */
+
+/*
+    Writes all input bytes (without braces) as elements in 'format', and
+    returns their CRC32C via 'out_checksum'.
+    Returns 0 on success, non-0 on error.
+*/
+static int write_input_bytes(bin2src_sink* sink, const InputData* input, const ElementFormat* format,
+                             unsigned long* out_checksum)
+{
+#if defined(BIN2SRC_THREADS)
+    if(input->size > PIPELINE_CHUNK_SIZE)
+    {
+        const int result = write_input_bytes_threaded(sink, input, format, out_checksum);
+        if(result != -1) return result;
+        /* Otherwise - fallback */
+    }
+#endif
+
+    return write_input_bytes_serial(sink, input, format, out_checksum);
+}
+
+/* Prints '--stats' report: throughput and utilisation (busy / wall time) of each stage */
+void bin2src_print_stats(FILE* output, const bin2src_stats* stats)
+{
+    const double wall_ms = (stats->wall_ms > 0.0) ? stats->wall_ms : 1e-9;
+
+    fprintf(output, "Stats: %lu byte(s) -> %lu character(s) (%.2fx) in %.3f ms (%.1f MiB/s)\n",
+            stats->bytes_in, stats->bytes_out,
+            (stats->bytes_in > 0) ? (double)stats->bytes_out / (double)stats->bytes_in : 0.0,
+            stats->wall_ms,
+            ((double)stats->bytes_in / (1024.0 * 1024.0)) / (wall_ms / 1000.0));
+
+    fprintf(output, "  read:   %10.3f ms busy (%5.1f%%)\n", stats->read_ms,   100.0 * stats->read_ms   / wall_ms);
+    fprintf(output, "  format: %10.3f ms busy (%5.1f%%)\n", stats->format_ms, 100.0 * stats->format_ms / wall_ms);
+    fprintf(output, "  write:  %10.3f ms busy (%5.1f%%)\n", stats->write_ms,  100.0 * stats->write_ms  / wall_ms);
+}
+
+/*
+    Writes in-memory bytes (without braces), in 'format' (its word size is
+    ignored). Returns 0 on success, non-0 on error
+*/
+static int write_bytes(bin2src_sink* sink, const char* bytes, size_t bytes_count, const ElementFormat* byte_format)
+{
+    InputData input;
+    ElementFormat format = *byte_format;
+    unsigned long checksum = 0;
+
+    format.word_size  = 1;
+    format.big_endian = 0;
+
+    input.file_name = NULL;
+    input.bytes     = bytes;
+    input.read      = NULL;
+    input.context   = NULL;
+    input.size      = bytes_count;
+    input.stats     = NULL;
+
+    return write_input_bytes(sink, &input, &format, &checksum);
+}
+
+/*
+    Writes (into the generated source) a bitwise '<name>_crc32c_compute()'
+    routine, used by the generated verify functions. 'storage' is its
+    prefix ("static ", maybe with 'BIN2SRC_UNUSED').
+*/
+static void write_crc32c_compute(bin2src_sink* sink, const char* var_name, const char* storage)
+{
+    sink_printf(sink,
+            "%sunsigned long %s_crc32c_compute(const unsigned char* p, size_t n)\n"
+            "{\n"
+            "    unsigned long crc = 0xFFFFFFFFUL;\n"
+            "    size_t i = 0;\n"
+            "    int bit = 0;\n"
+            "    for(; i < n; ++i)\n"
+            "    {\n"
+            "        crc ^= p[i];\n"
+            "        for(bit = 0; bit < 8; ++bit)\n"
+            "        {\n"
+            "            crc = (crc >> 1) ^ (0x82F63B78UL & (0UL - (crc & 1UL)));\n"
+            "        }\n"
+            "    }\n"
+            "    return (crc ^ 0xFFFFFFFFUL) & 0xFFFFFFFFUL;\n"
+            "}\n"
+            "\n",
+            storage, var_name);
+}
+
+/*
+    Writes (into the generated source) the 'verify_<name>_crc32c()'
+    function, that recomputes the checksum of 'bytes_expr' (of 'bytes_count'
+    bytes) and compares it against the generation-time value. The generated function returns 1
+    when the embedded data is intact.
+
+    It is wrapped into '#ifndef NDEBUG', so release builds don't pay
+    for it. 'storage' is a prefix for the verify function ("" or "static ").
+    Static functions (in the header of 'c_header' mode) are marked unused,
+    so translation units, that don't call them, build with '-Wall -Werror'.
+*/
+static void write_crc32c_verify(bin2src_sink* sink, const char* var_name,
+                                const char* storage, unsigned long checksum,
+                                const char* bytes_expr, size_t bytes_count)
+{
+    const int is_static = (storage[0] != '\0');
+
+    sink_printf(sink,
+            "\n"
+            "#ifndef NDEBUG\n");
+
+    if(is_static)
+    {
+        sink_printf(sink,
+                "\n"
+                "#if defined(__GNUC__)\n"
+                "    #define BIN2SRC_UNUSED __attribute__((unused))\n"
+                "#else\n"
+                "    #define BIN2SRC_UNUSED\n"
+                "#endif\n"
+                "\n");
+    }
+
+    write_crc32c_compute(sink, var_name, is_static ? "static BIN2SRC_UNUSED " : "static ");
+
+    sink_printf(sink,
+            "%sint verify_%s_crc32c() { return %s_crc32c_compute(%s, %lu) == 0x%.8lxUL; }\n",
+            is_static ? "static BIN2SRC_UNUSED " : "", var_name, var_name, bytes_expr, (unsigned long)bytes_count, checksum);
+
+    if(is_static)
+    {
+        sink_printf(sink, "\n#undef BIN2SRC_UNUSED\n");
+    }
+
+    sink_printf(sink, "#endif /* NDEBUG */\n");
+}
+
+/*
+    Same as write_crc32c_verify(), for data reconstructed at runtime:
+    checks the bytes, returned by 'get_<name>_data()'.
+*/
+static void write_crc32c_verify_data(bin2src_sink* sink, const char* var_name, unsigned long checksum)
+{
+    sink_printf(sink,
+            "\n"
+            "#ifndef NDEBUG\n");
+
+    write_crc32c_compute(sink, var_name, "static ");
+
+    sink_printf(sink,
+            "int verify_%s_crc32c()\n"
+            "{\n"
+            "    const %s_data* data = get_%s_data();\n"
+            "    return (data != NULL) && (%s_crc32c_compute(data->bytes, data->size) == 0x%.8lxUL);\n"
+            "}\n"
+            "#endif /* NDEBUG */\n",
+            var_name, var_name, var_name, var_name, checksum);
+}
+
+/* Writes the 'verify_<name>_crc32c()' declaration into the header */
+static void write_crc32c_verify_decl(bin2src_sink* sink, const char* var_name)
+{
+    sink_printf(sink,
+            "\n"
+            "#ifndef NDEBUG\n"
+            "int verify_%s_crc32c(); /* 1 if data is intact, 0 otherwise */\n"
+            "#endif /* NDEBUG */\n",
+            var_name);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Attention: You must free allocated memory manually! */
+static char* str_concat(const char* str1, const char* str2)
+{
+    /* via: https://stackoverflow.com/a/5901241/ */
+
+    const size_t str1_len = strlen(str1);
+    const size_t str2_len = strlen(str2);
+
+    char* new_str = malloc(str1_len + str2_len + 1);
+    if(new_str != NULL)
+    {
+        new_str[0] = '\0'; /* Ensures the memory is an empty string */
+        strcat(new_str, str1);
+        strcat(new_str, str2);
+
+        return new_str;
+    }
+    else
+    {
+        fprintf(stderr, "Error: cannot allocate memory for strings concatenation: %s and %s\n", str1, str2);
+        return NULL;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Writes the '<name>_data' struct definition, shared by the 'c_struct_*'
+    modes (and re-declared by delta outputs for their base asset, so both
+    definitions must stay the same).
+*/
+static void write_data_struct(bin2src_sink* sink, const char* var_name)
+{
+    sink_printf(sink,
+            "typedef struct %s_data\n"
+            "{\n"
+            "    const unsigned char* bytes;\n"
+            "    size_t               size;\n"
+            "    unsigned long        crc32c;\n"
+            "} %s_data;\n",
+            var_name, var_name);
+}
+
+/* C type of array elements */
+static const char* element_type_name(const ElementFormat* format)
+{
+    switch(format->word_size) {
+    case 2:  return "uint16_t";
+    case 4:  return "uint32_t";
+    case 8:  return "uint64_t";
+    default: return "unsigned char";
+    }
+}
+
+/* Writes '#include <stdint.h>' line, if elements are words */
+static void write_element_include(bin2src_sink* sink, const ElementFormat* format)
+{
+    if(format->word_size == 1) return;
+
+    sink_printf(sink, "#include <stdint.h> /* for %s */\n", element_type_name(format));
+}
+
+/*
+    Writes (before the array of words) '#include <stdint.h>' and the target
+    byte order check: words are meaningful as bytes only on targets with
+    the byte order they were generated for.
+*/
+static void write_element_prologue(bin2src_sink* sink, const char* var_name, const ElementFormat* format)
+{
+    const char* byte_order = format->big_endian ? "big" : "little";
+
+    if(format->word_size == 1) return;
+
+    write_element_include(sink, format);
+
+    sink_printf(sink,
+            "\n"
+            "#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_%s_ENDIAN__)\n"
+            "#error \"%s: generated for %s-endian targets (see bin2src --endian)\"\n"
+            "#endif\n"
+            "\n",
+            format->big_endian ? "BIG" : "LITTLE", var_name, byte_order);
+}
+
+/*
+    Writes the array declaration start: '<name>_bytes' in bytes mode,
+    or '<name>_words' otherwise. 'storage' is "static " or "".
+*/
+static void write_array_begin(bin2src_sink* sink, const char* storage, const char* var_name,
+                              size_t bytes_count, const ElementFormat* format)
+{
+    if(format->word_size == 1)
+    {
+        sink_printf(sink, "%sconst unsigned char %s_bytes[%lu] = {",
+                storage, var_name, (unsigned long)bytes_count);
+    }
+    else
+    {
+        sink_printf(sink, "%sconst %s %s_words[%lu] = {",
+                storage, element_type_name(format), var_name,
+                (unsigned long)((bytes_count + format->word_size - 1) / format->word_size));
+    }
+}
+
+/*
+    Writes into 'expr' (at least 300 bytes) a constant C expression of type
+    'const unsigned char*', pointing to the array start.
+*/
+static void make_bytes_expr(char* expr, const char* var_name, const ElementFormat* format)
+{
+    if(format->word_size == 1)
+    {
+        sprintf(expr, "%s_bytes", var_name);
+    }
+    else
+    {
+        sprintf(expr, "(const unsigned char*)%s_words", var_name);
+    }
+}
+
+static int write_C_header_single(
+        bin2src_sink* header,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        int with_verify)
+{
+    unsigned long checksum = 0; /* Computed while writing bytes */
+    char bytes_expr[300];
+
+    make_bytes_expr(bytes_expr, var_name, format);
+
+    sink_printf(header,
+            "#pragma once\n"
+            "\n"
+            "#include <stddef.h> /* for size_t */\n"
+            "\n");
+
+    write_element_prologue(header, var_name, format);
+    write_array_begin(header, "static ", var_name, input->size, format);
+
+    if(write_input_bytes(header, input, format, &checksum) != 0)
+    {
+        return 1;
+    }
+
+    sink_printf(header,
+            "\n"
+            "};\n"
+            "\n");
+
+    if(format->word_size != 1)
+    {
+        sink_printf(header, "static const unsigned char* const %s_bytes = %s;\n", var_name, bytes_expr);
+    }
+
+    sink_printf(header,
+            "static const size_t %s_size = %lu;\n"
+            "static const unsigned long %s_crc32c = 0x%.8lxUL;\n",
+            var_name, (unsigned long)input->size,
+            var_name, checksum
+    );
+
+    if(with_verify)
+    {
+        write_crc32c_verify(header, var_name, "static ", checksum, bytes_expr, input->size);
+    }
+
+    return header->error;
+}
+
+static int write_C_header_source_extern(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        int with_verify)
+{
+    unsigned long checksum = 0; /* Computed while writing bytes */
+    char bytes_expr[300];
+
+    /* ---------------------------------------------------------------------- */
+
+    make_bytes_expr(bytes_expr, var_name, format);
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n");
+
+        write_element_include(header, format);
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        if(format->word_size == 1)
+        {
+            sink_printf(header,
+                    "extern const unsigned char  %s_bytes[%lu];\n",
+                    var_name, (unsigned long)input->size);
+        }
+        else
+        {
+            sink_printf(header,
+                    "extern const %s %s_words[%lu];\n"
+                    "extern const unsigned char* const %s_bytes;\n",
+                    element_type_name(format), var_name,
+                    (unsigned long)((input->size + format->word_size - 1) / format->word_size),
+                    var_name);
+        }
+
+        sink_printf(header,
+                "extern const size_t         %s_size;\n"
+                "extern const unsigned long  %s_crc32c;\n",
+                var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(source, "#include \"%s\"\n", header_name);
+        sink_printf(source, "\n");
+
+        write_element_prologue(source, var_name, format);
+        write_array_begin(source, "", var_name, input->size, format);
+        if(write_input_bytes(source, input, format, &checksum) != 0)
+        {
+            return 1;
+        }
+        sink_printf(source,
+                "\n"
+                "};\n"
+                "\n");
+
+        if(format->word_size != 1)
+        {
+            sink_printf(source, "const unsigned char* const %s_bytes = %s;\n", var_name, bytes_expr);
+        }
+
+        sink_printf(source,
+                "const size_t %s_size = %lu;\n"
+                "const unsigned long %s_crc32c = 0x%.8lxUL;\n",
+                var_name, (unsigned long)input->size,
+                var_name, checksum);
+
+        if(with_verify)
+        {
+            write_crc32c_verify(source, var_name, "", checksum, bytes_expr, input->size);
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    return (header->error || source->error) ? 1 : 0;
+}
+
+static int write_C_header_source_funcs(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        int with_verify)
+{
+    unsigned long checksum = 0; /* Computed while writing bytes */
+    char bytes_expr[300];
+
+    /* ---------------------------------------------------------------------- */
+
+    make_bytes_expr(bytes_expr, var_name, format);
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n");
+
+        write_element_include(header, format);
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        sink_printf(header,
+                "const unsigned char* get_%s_bytes();\n"
+                "size_t               get_%s_size();\n"
+                "unsigned long        get_%s_crc32c();\n",
+                var_name, var_name, var_name);
+
+        if(format->word_size != 1)
+        {
+            sink_printf(header,
+                    "const %s* get_%s_words();\n",
+                    element_type_name(format), var_name);
+        }
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n", header_name);
+
+        write_element_prologue(source, var_name, format);
+        write_array_begin(source, "static ", var_name, input->size, format);
+        if(write_input_bytes(source, input, format, &checksum) != 0)
+        {
+            return 1;
+        }
+        sink_printf(source,
+                "\n"
+                "};\n"
+                "\n");
+
+        sink_printf(source,
+                "static const size_t %s_size = %lu;\n"
+                "static const unsigned long %s_crc32c = 0x%.8lxUL;\n",
+                var_name, (unsigned long)input->size,
+                var_name, checksum);
+
+        sink_printf(source,
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "const unsigned char* get_%s_bytes() { return %s; }\n",
+                var_name, bytes_expr);
+        sink_printf(source,
+                "size_t               get_%s_size()  { return %s_size; }\n",
+                var_name, var_name);
+        sink_printf(source,
+                "unsigned long        get_%s_crc32c() { return %s_crc32c; }\n",
+                var_name, var_name);
+
+        if(format->word_size != 1)
+        {
+            sink_printf(source,
+                    "const %s* get_%s_words() { return %s_words; }\n",
+                    element_type_name(format), var_name, var_name);
+        }
+
+        if(with_verify)
+        {
+            write_crc32c_verify(source, var_name, "", checksum, bytes_expr, input->size);
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    return (header->error || source->error) ? 1 : 0;
+}
+
+static int write_C_header_source_struct_extern(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        int with_verify)
+{
+    unsigned long checksum = 0; /* Computed while writing bytes */
+    char bytes_expr[300];
+
+    /* ---------------------------------------------------------------------- */
+
+    make_bytes_expr(bytes_expr, var_name, format);
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n"
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        write_data_struct(header, var_name);
+
+        sink_printf(header,
+                "\n"
+                "extern const %s_data %s;\n",
+                var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n", header_name);
+
+        write_element_prologue(source, var_name, format);
+        write_array_begin(source, "static ", var_name, input->size, format);
+        if(write_input_bytes(source, input, format, &checksum) != 0)
+        {
+            return 1;
+        }
+        sink_printf(source,
+                "\n"
+                "};\n");
+
+        sink_printf(source,
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "const %s_data %s = {%s, %lu, 0x%.8lxUL};\n",
+                var_name, var_name, bytes_expr, (unsigned long)input->size, checksum);
+
+        if(with_verify)
+        {
+            write_crc32c_verify(source, var_name, "", checksum, bytes_expr, input->size);
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    return (header->error || source->error) ? 1 : 0;
+}
+
+static int write_C_header_source_struct_func(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        int with_verify)
+{
+    unsigned long checksum = 0; /* Computed while writing bytes */
+    char bytes_expr[300];
+
+    /* ---------------------------------------------------------------------- */
+
+    make_bytes_expr(bytes_expr, var_name, format);
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n"
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        write_data_struct(header, var_name);
+
+        sink_printf(header,
+                "\n"
+                "const %s_data* get_%s_data();\n",
+                var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n", header_name);
+
+        write_element_prologue(source, var_name, format);
+        write_array_begin(source, "static ", var_name, input->size, format);
+        if(write_input_bytes(source, input, format, &checksum) != 0)
+        {
+            return 1;
+        }
+        sink_printf(source,
+                "\n"
+                "};\n");
+
+        sink_printf(source,
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "static const %s_data %s_data_struct = {%s, %lu, 0x%.8lxUL};\n"
+                "\n",
+                var_name, var_name, bytes_expr, (unsigned long) input->size, checksum);
+
+        sink_printf(source,
+                "const %s_data* get_%s_data() { return &%s_data_struct; }\n",
+                var_name, var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify(source, var_name, "", checksum, bytes_expr, input->size);
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    return (header->error || source->error) ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Delta encoding ('--base'): the input is described as a sequence of
+    operations against a base asset, which is already embedded (via
+    'c_struct_func' mode):
+
+      - DELTA_COPY   - copy 'length' bytes from the base, at 'offset'
+      - DELTA_INSERT - copy 'length' bytes from the literals, at 'offset'
+
+    Matching is rsync-like: base is indexed by hashes of its aligned
+    DELTA_BLOCK_SIZE blocks, the input is scanned with a rolling hash at
+    every position, and each verified match is extended in both directions.
+    So generated source size is proportional to the difference, not to
+    the whole input.
+*/
+
+#define DELTA_COPY       0
+#define DELTA_INSERT     1
+#define DELTA_BLOCK_SIZE 16
+#define DELTA_MAX_CHAIN  32  /* Candidates checked per position */
+#define DELTA_HASH_MUL   0x01000193UL
+
+typedef struct {
+    unsigned long* ops;          /* Triples: kind, offset, length */
+    size_t         ops_count;    /* Number of triples */
+    size_t         ops_capacity;
+
+    char*          literals;     /* Inserted bytes */
+    size_t         literals_count;
+    size_t         literals_capacity;
+
+    size_t         copied_count; /* Bytes copied from base */
+} Delta;
+
+static void free_delta(Delta* delta)
+{
+    free(delta->ops);
+    free(delta->literals);
+}
+
+/* Returns 0 on success, non-0 on allocation failure */
+static int delta_push(Delta* delta, unsigned long kind, const char* bytes, size_t offset, size_t length)
+{
+    if(length == 0) return 0;
+
+    if(delta->ops_count == delta->ops_capacity)
+    {
+        const size_t new_capacity = (delta->ops_capacity == 0) ? 256 : delta->ops_capacity * 2;
+        unsigned long* new_ops = (unsigned long*) realloc(delta->ops, new_capacity * 3 * sizeof(unsigned long));
+        if(new_ops == NULL) return 1;
+
+        delta->ops          = new_ops;
+        delta->ops_capacity = new_capacity;
+    }
+
+    if(kind == DELTA_INSERT)
+    {
+        if(delta->literals_count + length > delta->literals_capacity)
+        {
+            size_t new_capacity = (delta->literals_capacity == 0) ? 4096 : delta->literals_capacity * 2;
+            char* new_literals = NULL;
+
+            while(new_capacity < delta->literals_count + length) new_capacity *= 2;
+
+            new_literals = (char*) realloc(delta->literals, new_capacity);
+            if(new_literals == NULL) return 1;
+
+            delta->literals          = new_literals;
+            delta->literals_capacity = new_capacity;
+        }
+
+        memcpy(delta->literals + delta->literals_count, bytes + offset, length);
+        offset = delta->literals_count; /* Now - offset in literals */
+        delta->literals_count += length;
+    }
+    else
+    {
+        delta->copied_count += length;
+    }
+
+    delta->ops[delta->ops_count * 3 + 0] = kind;
+    delta->ops[delta->ops_count * 3 + 1] = (unsigned long)offset;
+    delta->ops[delta->ops_count * 3 + 2] = (unsigned long)length;
+    ++delta->ops_count;
+
+    return 0;
+}
+
+static unsigned long delta_block_hash(const char* bytes)
+{
+    unsigned long hash = 0;
+    size_t i = 0;
+    for(; i < DELTA_BLOCK_SIZE; ++i)
+    {
+        hash = (hash * DELTA_HASH_MUL + (unsigned long)(bytes[i] & 0xff)) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+/* Returns 0 on success, non-0 on error. Free the result with free_delta() */
+static int compute_delta(const char* base, size_t base_count,
+                         const char* bytes, size_t bytes_count,
+                         Delta* out_delta)
+{
+    const size_t NO_BLOCK = (size_t)-1;
+
+    const size_t blocks_count = base_count / DELTA_BLOCK_SIZE;
+    size_t  table_size = 1024;
+    size_t* table_head = NULL;
+    size_t* block_next = NULL;
+
+    unsigned long out_factor = 1; /* DELTA_HASH_MUL ^ (DELTA_BLOCK_SIZE - 1) */
+    unsigned long hash = 0;
+
+    size_t i = 0;
+    size_t literal_start = 0;
+    int result = 0;
+
+    Delta delta;
+    memset(&delta, 0, sizeof(delta));
+
+    while(table_size < blocks_count * 2) table_size *= 2;
+
+    table_head = (size_t*) malloc(table_size * sizeof(size_t));
+    block_next = (size_t*) malloc((blocks_count + 1) * sizeof(size_t));
+    if(table_head == NULL || block_next == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for delta index\n");
+
+        free(table_head);
+        free(block_next);
+        return 1;
+    }
+
+    /* Index base blocks (in reverse, so chains start from the lowest offset) */
+    for(i = 0; i < table_size; ++i) table_head[i] = NO_BLOCK;
+    for(i = blocks_count; i > 0; --i)
+    {
+        const size_t block  = i - 1;
+        const size_t bucket = delta_block_hash(base + block * DELTA_BLOCK_SIZE) & (table_size - 1);
+
+        block_next[block]  = table_head[bucket];
+        table_head[bucket] = block;
+    }
+
+    for(i = 1; i < DELTA_BLOCK_SIZE; ++i)
+    {
+        out_factor = (out_factor * DELTA_HASH_MUL) & 0xFFFFFFFFUL;
+    }
+
+    /* Scan the input */
+    i = 0;
+    if(bytes_count >= DELTA_BLOCK_SIZE) hash = delta_block_hash(bytes);
+
+    while(result == 0 && blocks_count > 0 && i + DELTA_BLOCK_SIZE <= bytes_count)
+    {
+        size_t best_offset = 0;
+        size_t best_length = 0;
+        size_t chain = 0;
+        size_t block = table_head[hash & (table_size - 1)];
+
+        for(; block != NO_BLOCK && chain < DELTA_MAX_CHAIN; block = block_next[block], ++chain)
+        {
+            const size_t offset = block * DELTA_BLOCK_SIZE;
+            size_t length = DELTA_BLOCK_SIZE;
+
+            if(memcmp(base + offset, bytes + i, DELTA_BLOCK_SIZE) != 0) continue;
+
+            while( (offset + length < base_count) && (i + length < bytes_count) &&
+                   (base[offset + length] == bytes[i + length]) )
+            {
+                ++length;
+            }
+
+            if(length > best_length)
+            {
+                best_offset = offset;
+                best_length = length;
+            }
+        }
+
+        if(best_length > 0)
+        {
+            /* Extend backward, into not yet emitted literals */
+            size_t back = 0;
+            while( (back < i - literal_start) && (back < best_offset) &&
+                   (base[best_offset - back - 1] == bytes[i - back - 1]) )
+            {
+                ++back;
+            }
+
+            result = delta_push(&delta, DELTA_INSERT, bytes, literal_start, (i - back) - literal_start);
+            if(result == 0)
+            {
+                result = delta_push(&delta, DELTA_COPY, bytes, best_offset - back, best_length + back);
+            }
+
+            i += best_length;
+            literal_start = i;
+
+            if(i + DELTA_BLOCK_SIZE <= bytes_count) hash = delta_block_hash(bytes + i);
+        }
+        else
+        {
+            if(i + DELTA_BLOCK_SIZE < bytes_count)
+            {
+                /* Roll: drop bytes[i], append bytes[i + DELTA_BLOCK_SIZE] */
+                hash = (hash - out_factor * (unsigned long)(bytes[i] & 0xff)) & 0xFFFFFFFFUL;
+                hash = (hash * DELTA_HASH_MUL + (unsigned long)(bytes[i + DELTA_BLOCK_SIZE] & 0xff)) & 0xFFFFFFFFUL;
+            }
+            ++i;
+        }
+    }
+
+    if(result == 0)
+    {
+        result = delta_push(&delta, DELTA_INSERT, bytes, literal_start, bytes_count - literal_start);
+    }
+
+    free(table_head);
+    free(block_next);
+
+    if(result != 0)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for delta\n");
+
+        free_delta(&delta);
+        return 1;
+    }
+
+    *out_delta = delta;
+    return 0;
+}
+
+/*
+    Same interface as 'c_struct_func' mode, but '<name>_data' is
+    reconstructed on the first 'get_<name>_data()' call, from the base asset
+    (accessed via 'get_<base_name>_data()') and the delta.
+
+    Notice: the first call is not thread-safe, call it once during
+    initialization if the data is shared between threads.
+*/
+static int write_C_header_source_struct_delta(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const char* bytes, size_t bytes_count,
+        const char* base_var_name,
+        const char* base_bytes, size_t base_bytes_count,
+        const ElementFormat* format,
+        int with_verify, FILE* log)
+{
+    const unsigned long checksum      = crc32c(bytes, bytes_count);
+    const unsigned long base_checksum = crc32c(base_bytes, base_bytes_count);
+
+    Delta delta;
+    size_t i = 0;
+
+    /* ---------------------------------------------------------------------- */
+
+    if(compute_delta(base_bytes, base_bytes_count, bytes, bytes_count, &delta) != 0)
+    {
+        return 1;
+    }
+
+    if(log != NULL)
+    {
+        fprintf(log, "Delta: %lu op(s), %lu byte(s) copied from %s, %lu byte(s) inserted (%.1f%% of input)\n",
+                (unsigned long)delta.ops_count, (unsigned long)delta.copied_count, base_var_name,
+                (unsigned long)delta.literals_count, 100.0 * (double)delta.literals_count / (double)bytes_count);
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n"
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        write_data_struct(header, var_name);
+
+        sink_printf(header,
+                "\n"
+                "/* Reconstructed from '%s' on the first call (not thread-safe), NULL if out of memory or the base changed */\n"
+                "const %s_data* get_%s_data();\n",
+                base_var_name, var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n"
+                "#include <stdlib.h> /* for malloc() */\n"
+                "#include <string.h> /* for memcpy() */\n"
+                "#include <assert.h> /* for assert() */\n"
+                "\n", header_name);
+
+        /* Base asset, same declarations as in its own header */
+        write_data_struct(source, base_var_name);
+        sink_printf(source,
+                "\n"
+                "const %s_data* get_%s_data();\n"
+                "\n",
+                base_var_name, base_var_name);
+
+        /* Literals (C doesn't allow empty arrays) */
+        if(delta.literals_count > 0)
+        {
+            sink_printf(source, "static const unsigned char %s_literals[%lu] = {", var_name, (unsigned long)delta.literals_count);
+            write_bytes(source, delta.literals, delta.literals_count, format);
+            sink_printf(source,
+                    "\n"
+                    "};\n"
+                    "\n");
+        }
+        else
+        {
+            sink_printf(source, "static const unsigned char %s_literals[1] = { 0x00 };\n\n", var_name);
+        }
+
+        /* Operations */
+        sink_printf(source,
+                "/* Triples: kind (0 - copy from base, 1 - insert from literals), offset, length */\n"
+                "static const unsigned long %s_delta_ops[%lu] = {",
+                var_name, (unsigned long)delta.ops_count * 3);
+        for(i = 0; i < delta.ops_count; ++i)
+        {
+            sink_printf(source, "%s\n\t%lu, %lu, %lu",
+                    (i == 0) ? "" : ",",
+                    delta.ops[i * 3 + 0], delta.ops[i * 3 + 1], delta.ops[i * 3 + 2]);
+        }
+        sink_printf(source,
+                "\n"
+                "};\n");
+
+        sink_printf(source,
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "static %s_data %s_data_struct = {NULL, %lu, 0x%.8lxUL};\n"
+                "\n",
+                var_name, var_name, (unsigned long)bytes_count, checksum);
+
+        sink_printf(source,
+                "const %s_data* get_%s_data()\n"
+                "{\n"
+                "    if(%s_data_struct.bytes == NULL)\n"
+                "    {\n"
+                "        const %s_data* base = get_%s_data();\n"
+                "        unsigned char* bytes = NULL;\n"
+                "        size_t size = 0;\n"
+                "        size_t i = 0;\n"
+                "\n"
+                "        if(base == NULL) return NULL; /* Compressed or delta base, out of memory */\n"
+                "\n",
+                var_name, var_name,
+                var_name,
+                base_var_name, base_var_name);
+
+        /* Checked in release builds too: copies from a changed base may run past its end */
+        sink_printf(source,
+                "        if(base->size != %luUL || base->crc32c != 0x%.8lxUL)\n"
+                "        {\n"
+                "            assert(!\"base asset changed, regenerate the delta\");\n"
+                "            return NULL;\n"
+                "        }\n"
+                "\n"
+                "        bytes = (unsigned char*) malloc(%lu);\n"
+                "        if(bytes == NULL) return NULL;\n"
+                "\n",
+                (unsigned long)base_bytes_count, base_checksum,
+                (unsigned long)bytes_count);
+
+        sink_printf(source,
+                "        for(; i < sizeof(%s_delta_ops) / sizeof(%s_delta_ops[0]); i += 3)\n"
+                "        {\n"
+                "            const unsigned char* src = (%s_delta_ops[i] == 0) ? base->bytes : %s_literals;\n"
+                "            memcpy(bytes + size, src + %s_delta_ops[i + 1], %s_delta_ops[i + 2]);\n"
+                "            size += %s_delta_ops[i + 2];\n"
+                "        }\n"
+                "\n",
+                var_name, var_name,
+                var_name, var_name,
+                var_name, var_name,
+                var_name);
+
+        sink_printf(source,
+                "        %s_data_struct.bytes = bytes;\n"
+                "    }\n"
+                "\n"
+                "    return &%s_data_struct;\n"
+                "}\n",
+                var_name,
+                var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_data(source, var_name, checksum);
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    free_delta(&delta);
+
+    return (header->error || source->error) ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Seekable compression ('--compress'): the input is split into blocks of
+    'block_size' bytes, compressed independently, and indexed by their
+    offsets. So the generated 'read_<name>(offset, length, dst)' decompresses
+    only the blocks it touches, instead of the whole asset.
+
+    Blocks are compressed by LZ77 (greedy, hash of 4 bytes), as LZ4-like
+    sequences:
+
+      - token    - literals count (high 4 bits), match length - 4 (low 4 bits),
+                   where 15 is continued by bytes, up to the first non-255 one
+      - literals
+      - offset   - 2 bytes, little-endian, back from the current position
+
+    The last sequence of a block has no match. Blocks that don't get smaller
+    are stored as is, so they are recognized by their size. The generated
+    decoder is tiny and trusts the embedded data (see '--verify').
+*/
+
+#define LZ_MIN_MATCH  4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS  14
+#define LZ_HASH_SIZE  (1 << LZ_HASH_BITS)
+
+static size_t lz_hash(const unsigned char* p)
+{
+    const unsigned long value = (unsigned long)p[0]
+                              | ((unsigned long)p[1] <<  8)
+                              | ((unsigned long)p[2] << 16)
+                              | ((unsigned long)p[3] << 24);
+
+    return (size_t)(((value * 2654435761UL) & 0xFFFFFFFFUL) >> (32 - LZ_HASH_BITS));
+}
+
+/* Writes the continuation of a length (after 15 in the token) */
+static unsigned char* lz_put_length(unsigned char* out, size_t length)
+{
+    for(; length >= 255; length -= 255) *out++ = 255;
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+/* Writes the token and literals of a sequence. Returns the token position */
+static unsigned char* lz_put_literals(unsigned char** out, const unsigned char* literals, size_t literals_count)
+{
+    unsigned char* token = (*out)++;
+
+    *token = (unsigned char)(((literals_count < 15) ? literals_count : 15) << 4);
+    if(literals_count >= 15) *out = lz_put_length(*out, literals_count - 15);
+
+    memcpy(*out, literals, literals_count);
+    *out += literals_count;
+
+    return token;
+}
+
+/*
+    Compresses 'src' into 'dst'. 'table' (of LZ_HASH_SIZE entries) is a
+    scratch space. Returns the compressed size, or 0 if it doesn't fit into
+    'dst_capacity' bytes.
+*/
+static size_t lz_compress(const unsigned char* src, size_t src_size,
+                          unsigned char* dst, size_t dst_capacity,
+                          size_t* table)
+{
+    unsigned char* out = dst;
+    size_t anchor = 0; /* Start of pending literals */
+    size_t i = 0;
+
+    /* Positions + 1 of the last occurrence of each hash, 0 - none */
+    memset(table, 0, LZ_HASH_SIZE * sizeof(size_t));
+
+    while(i + LZ_MIN_MATCH <= src_size)
+    {
+        const size_t hash      = lz_hash(src + i);
+        const size_t candidate = table[hash];
+
+        table[hash] = i + 1;
+
+        if( (candidate != 0) && (i - (candidate - 1) <= LZ_MAX_OFFSET) &&
+            (memcmp(src + candidate - 1, src + i, LZ_MIN_MATCH) == 0) )
+        {
+            const size_t match          = candidate - 1;
+            const size_t literals_count = i - anchor;
+            size_t length = LZ_MIN_MATCH;
+            unsigned char* token = NULL;
+
+            while(i + length < src_size && src[match + length] == src[i + length]) ++length;
+
+            /* Worst case: token, literals (and their length), offset, match length */
+            if((size_t)(dst + dst_capacity - out) < 1 + literals_count + literals_count / 255 + 1 + 2 + length / 255 + 1)
+            {
+                return 0;
+            }
+
+            token = lz_put_literals(&out, src + anchor, literals_count);
+
+            *out++ = (unsigned char)((i - match) & 0xff);
+            *out++ = (unsigned char)((i - match) >> 8);
+
+            *token |= (unsigned char)((length - LZ_MIN_MATCH < 15) ? length - LZ_MIN_MATCH : 15);
+            if(length - LZ_MIN_MATCH >= 15) out = lz_put_length(out, length - LZ_MIN_MATCH - 15);
+
+            i += length;
+            anchor = i;
+        }
+        else
+        {
+            i += 1 + ((i - anchor) >> 6); /* Skip faster through incompressible data */
+        }
+    }
+
+    /* Last literals */
+    {
+        const size_t literals_count = src_size - anchor;
+
+        if((size_t)(dst + dst_capacity - out) < 1 + literals_count + literals_count / 255 + 1)
+        {
+            return 0;
+        }
+
+        lz_put_literals(&out, src + anchor, literals_count);
+    }
+
+    return (size_t)(out - dst);
+}
+
+/* Writes (into the generated source) the 'BIN2SRC_THREAD_LOCAL' storage class */
+static void write_thread_local(bin2src_sink* sink)
+{
+    sink_printf(sink,
+            "#ifndef BIN2SRC_THREAD_LOCAL\n"
+            "    #if defined(__cplusplus) && (__cplusplus >= 201103L)\n"
+            "        #define BIN2SRC_THREAD_LOCAL thread_local\n"
+            "    #elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)\n"
+            "        #define BIN2SRC_THREAD_LOCAL _Thread_local\n"
+            "    #elif defined(__GNUC__)\n"
+            "        #define BIN2SRC_THREAD_LOCAL __thread\n");
+    sink_printf(sink,
+            "    #elif defined(_MSC_VER)\n"
+            "        #define BIN2SRC_THREAD_LOCAL __declspec(thread)\n"
+            "    #endif /* Unknown compiler: no per-thread cache, see read_<name>() */\n"
+            "#endif\n"
+            "\n");
+}
+
+/*
+    Writes (into the generated source) the block decoder and accessors.
+    'has_stored' - if some blocks are stored as is (otherwise their check is
+    omitted, it only costs and confuses compiler's bounds warnings).
+*/
+static void write_compressed_accessors(bin2src_sink* sink, const char* var_name, int has_stored)
+{
+    const char* n = var_name;
+
+    sink_printf(sink,
+            "static size_t %s_block_length(size_t block)\n"
+            "{\n"
+            "    return (block + 1 < %s_blocks_count) ? %s_block_size : %s_size - block * %s_block_size;\n"
+            "}\n"
+            "\n",
+            n, n, n, n, n);
+
+    sink_printf(sink,
+            "static void %s_decompress_block(size_t block, unsigned char* dst)\n"
+            "{\n"
+            "    const unsigned char* src     = %s_compressed + %s_blocks[block];\n"
+            "    const unsigned char* src_end = %s_compressed + %s_blocks[block + 1];\n"
+            "\n",
+            n, n, n, n, n);
+
+    if(has_stored)
+    {
+        sink_printf(sink,
+                "    if((size_t)(src_end - src) == %s_block_length(block))\n"
+                "    {\n"
+                "        memcpy(dst, src, (size_t)(src_end - src)); /* Stored as is */\n"
+                "        return;\n"
+                "    }\n"
+                "\n",
+                n);
+    }
+
+    sink_printf(sink,
+            "    for(;;)\n"
+            "    {\n"
+            "        const unsigned int token = *src++;\n"
+            "        size_t length = token >> 4;\n"
+            "        unsigned int next = 255;\n"
+            "\n"
+            "        if(length == 15) for(; next == 255; length += next) next = *src++;\n"
+            "        memcpy(dst, src, length);\n"
+            "        dst += length;\n"
+            "        src += length;\n"
+            "\n"
+            "        if(src >= src_end) break;\n"
+            "\n");
+
+    sink_printf(sink,
+            "        {\n"
+            "            const unsigned char* match = dst - ((size_t)src[0] | ((size_t)src[1] << 8));\n"
+            "            src += 2;\n"
+            "\n"
+            "            length = token & 15;\n"
+            "            next = 255;\n"
+            "            if(length == 15) for(; next == 255; length += next) next = *src++;\n"
+            "\n"
+            "            for(length += 4; length > 0; --length) *dst++ = *match++; /* May overlap */\n"
+            "        }\n"
+            "    }\n"
+            "}\n"
+            "\n");
+
+    sink_printf(sink,
+            "#if defined(BIN2SRC_THREAD_LOCAL)\n"
+            "/* Last partially read block of each thread: its index + 1 (0 - none) and bytes */\n"
+            "static BIN2SRC_THREAD_LOCAL size_t         %s_cached_block = 0;\n"
+            "static BIN2SRC_THREAD_LOCAL unsigned char* %s_cache        = NULL;\n"
+            "#endif\n"
+            "\n"
+            "void release_%s_cache()\n"
+            "{\n"
+            "#if defined(BIN2SRC_THREAD_LOCAL)\n"
+            "    free(%s_cache);\n"
+            "    %s_cache        = NULL;\n"
+            "    %s_cached_block = 0;\n"
+            "#endif\n"
+            "}\n"
+            "\n",
+            n, n, n, n, n, n);
+
+    sink_printf(sink,
+            "size_t read_%s(size_t offset, size_t length, void* dst)\n"
+            "{\n"
+            "#if defined(BIN2SRC_THREAD_LOCAL)\n"
+            "    size_t         cached_block = %s_cached_block;\n"
+            "    unsigned char* cache        = %s_cache;\n"
+            "#else\n"
+            "    /* No thread-local storage: a partially read block is decompressed for this call only */\n"
+            "    size_t         cached_block = 0;\n"
+            "    unsigned char* cache        = NULL;\n"
+            "#endif\n"
+            "\n"
+            "    unsigned char* out = (unsigned char*) dst;\n"
+            "    size_t copied = 0;\n"
+            "\n",
+            n, n, n);
+
+    sink_printf(sink,
+            "    if(offset >= %s_size) return 0;\n"
+            "    if(length > %s_size - offset) length = %s_size - offset;\n"
+            "\n",
+            n, n, n);
+
+    sink_printf(sink,
+            "    while(copied < length)\n"
+            "    {\n"
+            "        const size_t block        = (offset + copied) / %s_block_size;\n"
+            "        const size_t block_offset = (offset + copied) %% %s_block_size;\n"
+            "        const size_t block_length = %s_block_length(block);\n"
+            "        size_t part = block_length - block_offset;\n"
+            "\n"
+            "        if(part > length - copied) part = length - copied;\n"
+            "\n",
+            n, n, n);
+
+    sink_printf(sink,
+            "        if(part == block_length)\n"
+            "        {\n"
+            "            %s_decompress_block(block, out + copied); /* Whole block, not cached */\n"
+            "        }\n"
+            "        else\n"
+            "        {\n"
+            "            if(cached_block != block + 1)\n"
+            "            {\n"
+            "                if(cache == NULL) cache = (unsigned char*) malloc(%s_block_size);\n"
+            "                if(cache == NULL) break;\n"
+            "\n"
+            "                %s_decompress_block(block, cache);\n"
+            "                cached_block = block + 1;\n"
+            "            }\n",
+            n, n, n);
+
+    sink_printf(sink,
+            "            memcpy(out + copied, cache + block_offset, part);\n"
+            "        }\n"
+            "\n"
+            "        copied += part;\n"
+            "    }\n"
+            "\n"
+            "#if defined(BIN2SRC_THREAD_LOCAL)\n"
+            "    %s_cached_block = cached_block;\n"
+            "    %s_cache        = cache;\n"
+            "#else\n"
+            "    free(cache);\n"
+            "#endif\n"
+            "\n"
+            "    return copied;\n"
+            "}\n"
+            "\n",
+            n, n);
+
+    sink_printf(sink,
+            "size_t get_%s_size() { return %s_size; }\n"
+            "\n"
+            "const %s_data* get_%s_data()\n"
+            "{\n"
+            "    if(%s_data_struct.bytes == NULL)\n"
+            "    {\n"
+            "        unsigned char* bytes = (unsigned char*) malloc(%s_size);\n"
+            "        if(bytes == NULL) return NULL;\n"
+            "\n"
+            "        read_%s(0, %s_size, bytes);\n"
+            "        %s_data_struct.bytes = bytes;\n"
+            "    }\n"
+            "\n"
+            "    return &%s_data_struct;\n"
+            "}\n",
+            n, n, n, n, n, n, n, n, n, n);
+}
+
+/*
+    Block compressor ('--threads', '--blocks-in-flight'): the conversion
+    thread reads (and checksums) blocks in order, workers compress and format
+    them, and the conversion thread writes them out in order. At most
+    'slots_count' blocks are in memory at once, whatever the input size.
+    Text of every block starts on a new line, so it doesn't depend on the
+    previous blocks, and output is the same for any number of workers.
+    Without workers (or BIN2SRC_THREADS) the conversion thread compresses
+    blocks itself, one at a time.
+*/
+
+typedef struct {
+    size_t         block;       /* Index */
+    const char*    data;        /* Slice of in-memory input, or 'buffer' */
+    size_t         size;
+    char*          buffer;      /* For streamed input */
+    unsigned char* compressed;
+    size_t*        table;       /* Scratch space of lz_compress() */
+    char*          text;        /* Formatted output */
+    size_t         text_size;
+    size_t         stored_size; /* In '<name>_compressed', equals 'size' if stored as is */
+    int            done;
+} CompressSlot;
+
+typedef struct {
+    const ElementFormat* format; /* Of bytes */
+    CompressSlot*   slots;
+    size_t          slots_count;
+    size_t          next_block;  /* Next block to compress */
+    size_t          read_blocks; /* Blocks in slots, or already written */
+    int             stop;
+    double          busy_ms;     /* Summed over workers */
+#if defined(BIN2SRC_THREADS)
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;        /* Signals both read and compressed blocks */
+#endif
+} Compressor;
+
+static void compress_slot(CompressSlot* slot, const ElementFormat* format)
+{
+    const char* data = slot->data;
+    size_t size = lz_compress((const unsigned char*) slot->data, slot->size, slot->compressed, slot->size - 1, slot->table);
+
+    /* Stored as is, unless it gets smaller */
+    if(size != 0)
+    {
+        data = (const char*) slot->compressed;
+    }
+    else
+    {
+        size = slot->size;
+    }
+
+    slot->stored_size = size;
+    slot->text_size   = format_elements(slot->text, data, size, slot->block * elements_per_line(format), format); /* From a new line */
+}
+
+#if defined(BIN2SRC_THREADS)
+
+static void* compressor_worker_thread(void* arg)
+{
+    Compressor* compressor = (Compressor*) arg;
+
+    pthread_mutex_lock(&compressor->mutex);
+    for(;;)
+    {
+        CompressSlot* slot = NULL;
+        double t = 0.0;
+
+        while(!compressor->stop && compressor->next_block == compressor->read_blocks)
+        {
+            pthread_cond_wait(&compressor->cond, &compressor->mutex);
+        }
+        if(compressor->next_block == compressor->read_blocks) break; /* Stopped */
+
+        slot = &compressor->slots[compressor->next_block % compressor->slots_count];
+        ++compressor->next_block;
+        pthread_mutex_unlock(&compressor->mutex);
+
+        t = now_ms();
+        compress_slot(slot, compressor->format);
+        t = now_ms() - t;
+
+        pthread_mutex_lock(&compressor->mutex);
+        compressor->busy_ms += t;
+        slot->done = 1;
+        pthread_cond_broadcast(&compressor->cond);
+    }
+    pthread_mutex_unlock(&compressor->mutex);
+
+    return NULL;
+}
+
+#endif /* BIN2SRC_THREADS */
+
+/* Number of compression workers for the 'threads' option, 0 - one per CPU */
+static size_t compressor_workers_count(size_t threads)
+{
+#if defined(BIN2SRC_THREADS)
+    if(threads == 0)
+    {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+    return (threads > 1) ? threads : 0; /* 1 - the conversion thread itself */
+#else
+    (void)threads;
+    return 0;
+#endif
+}
+
+/*
+    Writes compressed blocks of the input (without braces), fills block
+    offsets ('blocks_count' + 1) and returns the checksum of the input via
+    'out_checksum', and whether some blocks are stored as is via
+    'out_has_stored'. Returns 0 on success, non-0 on error.
+*/
+static int write_compressed_blocks(bin2src_sink* sink, const InputData* input, const ElementFormat* format,
+                                   size_t block_size, size_t threads, size_t blocks_in_flight,
+                                   unsigned long* blocks, unsigned long* out_checksum, int* out_has_stored)
+{
+    const size_t blocks_count = (input->size + block_size - 1) / block_size;
+
+    Compressor compressor;
+    size_t workers_count = compressor_workers_count(threads);
+    size_t written_blocks = 0;
+    size_t i = 0;
+
+    unsigned long crc = CRC32C_INIT;
+    int result = 0;
+    double t = 0.0;
+
+#if defined(BIN2SRC_THREADS)
+    pthread_t* workers = NULL;
+    size_t started_count = 0;
+#endif
+
+    compressor.slots_count = (workers_count == 0) ? 1 : (blocks_in_flight != 0) ? blocks_in_flight : workers_count * 2;
+    compressor.format      = format;
+    compressor.next_block  = 0;
+    compressor.read_blocks = 0;
+    compressor.stop        = 0;
+    compressor.busy_ms     = 0.0;
+
+    compressor.slots = (CompressSlot*) calloc(compressor.slots_count, sizeof(CompressSlot));
+    if(compressor.slots == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for compression\n");
+        return 1;
+    }
+
+    for(i = 0; i < compressor.slots_count; ++i)
+    {
+        CompressSlot* slot = &compressor.slots[i];
+
+        slot->buffer     = (input->bytes == NULL) ? (char*) malloc(block_size) : NULL;
+        slot->compressed = (unsigned char*) malloc(block_size);
+        slot->table      = (size_t*) malloc(LZ_HASH_SIZE * sizeof(size_t));
+        slot->text       = (char*) malloc(PIPELINE_FORMATTED_SIZE(block_size));
+
+        if( (input->bytes == NULL && slot->buffer == NULL) || slot->compressed == NULL || slot->table == NULL || slot->text == NULL )
+        {
+            fprintf(stderr, "Error: cannot allocate memory for compression\n");
+            result = 1;
+        }
+    }
+
+#if defined(BIN2SRC_THREADS)
+    if(result == 0 && workers_count > 0)
+    {
+        pthread_mutex_init(&compressor.mutex, NULL);
+        pthread_cond_init(&compressor.cond, NULL);
+
+        workers = (pthread_t*) malloc(workers_count * sizeof(pthread_t));
+        for(; workers != NULL && started_count < workers_count; ++started_count)
+        {
+            if(pthread_create(&workers[started_count], NULL, compressor_worker_thread, &compressor) != 0) break;
+        }
+    }
+    if(started_count == 0 && workers_count > 0)
+    {
+        if(result == 0)
+        {
+            pthread_cond_destroy(&compressor.cond);
+            pthread_mutex_destroy(&compressor.mutex);
+        }
+        workers_count = 0; /* Fallback: compressed by the conversion thread */
+    }
+#endif
+
+    /* Reads ahead while there are free slots, otherwise writes the oldest block */
+    blocks[0] = 0;
+    while(result == 0 && written_blocks < blocks_count)
+    {
+        const size_t read_blocks = compressor.read_blocks;
+
+        if( (read_blocks < blocks_count) && (read_blocks - written_blocks < compressor.slots_count) )
+        {
+            CompressSlot* slot = &compressor.slots[read_blocks % compressor.slots_count];
+            const size_t offset = read_blocks * block_size;
+
+            slot->block = read_blocks;
+            slot->size  = (input->size - offset < block_size) ? input->size - offset : block_size;
+            slot->data  = slot->buffer;
+            slot->done  = 0;
+
+            t = now_ms();
+            if(input->bytes != NULL)
+            {
+                slot->data = input->bytes + offset;
+            }
+            else if(read_exactly(input, slot->buffer, slot->size) != 0)
+            {
+                fprintf(stderr, "Error: cannot read the whole file %s (was it changed during conversion?)\n", input->file_name);
+                result = 1;
+                break;
+            }
+            crc = crc32c_update(crc, slot->data, slot->size);
+            if(input->stats != NULL) input->stats->read_ms += now_ms() - t;
+
+            if(workers_count == 0)
+            {
+                t = now_ms();
+                compress_slot(slot, compressor.format);
+                slot->done = 1;
+                compressor.busy_ms += now_ms() - t;
+
+                ++compressor.read_blocks;
+            }
+#if defined(BIN2SRC_THREADS)
+            else
+            {
+                pthread_mutex_lock(&compressor.mutex);
+                ++compressor.read_blocks;
+                pthread_cond_broadcast(&compressor.cond);
+                pthread_mutex_unlock(&compressor.mutex);
+            }
+#endif
+        }
+        else
+        {
+            CompressSlot* slot = &compressor.slots[written_blocks % compressor.slots_count];
+
+#if defined(BIN2SRC_THREADS)
+            if(workers_count > 0)
+            {
+                pthread_mutex_lock(&compressor.mutex);
+                while(!slot->done)
+                {
+                    pthread_cond_wait(&compressor.cond, &compressor.mutex);
+                }
+                pthread_mutex_unlock(&compressor.mutex);
+            }
+#endif
+
+            t = now_ms();
+            if(sink_write(sink, slot->text, slot->text_size) != 0)
+            {
+                result = 1;
+                break;
+            }
+            if(input->stats != NULL)
+            {
+                input->stats->write_ms  += now_ms() - t;
+                input->stats->bytes_out += (unsigned long)slot->text_size;
+            }
+
+            if(slot->stored_size == slot->size) *out_has_stored = 1;
+            blocks[written_blocks + 1] = blocks[written_blocks] + (unsigned long)slot->stored_size;
+            ++written_blocks;
+        }
+    }
+
+#if defined(BIN2SRC_THREADS)
+    if(workers_count > 0)
+    {
+        pthread_mutex_lock(&compressor.mutex);
+        compressor.stop = 1;
+        pthread_cond_broadcast(&compressor.cond);
+        pthread_mutex_unlock(&compressor.mutex);
+
+        for(i = 0; i < started_count; ++i)
+        {
+            pthread_join(workers[i], NULL);
+        }
+
+        pthread_cond_destroy(&compressor.cond);
+        pthread_mutex_destroy(&compressor.mutex);
+    }
+    free(workers);
+#endif
+
+    if(input->stats != NULL) input->stats->format_ms += compressor.busy_ms;
+
+    for(i = 0; i < compressor.slots_count; ++i)
+    {
+        free(compressor.slots[i].buffer);
+        free(compressor.slots[i].compressed);
+        free(compressor.slots[i].table);
+        free(compressor.slots[i].text);
+    }
+    free(compressor.slots);
+
+    *out_checksum = crc32c_final(crc);
+    return result;
+}
+
+static int write_C_header_source_struct_compressed(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const char* var_name,
+        const InputData* input, const ElementFormat* format,
+        size_t block_size, size_t threads, size_t blocks_in_flight,
+        int with_verify, FILE* log)
+{
+    const size_t blocks_count = (input->size + block_size - 1) / block_size;
+
+    /* Offsets of blocks in '<name>_compressed' */
+    unsigned long* blocks = (unsigned long*) malloc((blocks_count + 1) * sizeof(unsigned long));
+
+    unsigned long checksum = 0;
+    size_t block = 0;
+    int has_stored = 0;
+    int result = 0;
+
+    const double started_at = now_ms();
+
+    if(blocks == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for compression\n");
+        result = 1;
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    if(result == 0)
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n"
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        write_data_struct(header, var_name);
+
+        sink_printf(header,
+                "\n"
+                "/* Decompressed on the first call (not thread-safe), NULL if out of memory */\n"
+                "const %s_data* get_%s_data();\n"
+                "\n"
+                "size_t get_%s_size();\n"
+                "\n",
+                var_name, var_name, var_name);
+
+        sink_printf(header,
+                "/*\n"
+                "    Copies up to 'length' bytes at 'offset' into 'dst', decompressing only the\n"
+                "    touched blocks. Thread-safe. A partially read block is cached per thread\n"
+                "    (without thread-local storage in the compiler - decompressed on every call).\n"
+                "    Returns the number of copied bytes (less than 'length' at the end of data,\n"
+                "    or if out of memory).\n"
+                "*/\n"
+                "size_t read_%s(size_t offset, size_t length, void* dst);\n",
+                var_name);
+
+        sink_printf(header,
+                "\n"
+                "/* Frees the block, cached by read_%s() for the calling thread. Call it before the thread exits */\n"
+                "void release_%s_cache();\n",
+                var_name, var_name);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_decl(header, var_name);
+        }
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    if(result == 0)
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n"
+                "#include <stdlib.h> /* for malloc() */\n"
+                "#include <string.h> /* for memcpy() */\n"
+                "\n", header_name);
+
+        write_thread_local(source);
+
+        sink_printf(source, "static const unsigned char %s_compressed[] = {", var_name);
+
+        result = write_compressed_blocks(source, input, format, block_size, threads, blocks_in_flight,
+                                         blocks, &checksum, &has_stored);
+    }
+
+    if(result == 0)
+    {
+        const size_t compressed_size = (size_t)blocks[blocks_count];
+
+        sink_printf(source,
+                "\n"
+                "};\n"
+                "\n"
+                "/* Block 'i' is at [%s_blocks[i], %s_blocks[i + 1]) in '%s_compressed' */\n"
+                "static const unsigned long %s_blocks[%lu] = {",
+                var_name, var_name, var_name,
+                var_name, (unsigned long)blocks_count + 1);
+
+        for(block = 0; block <= blocks_count; ++block)
+        {
+            sink_printf(source, "%s%s%lu", (block == 0) ? "" : ",", (block % 8 == 0) ? "\n\t" : " ", blocks[block]);
+        }
+
+        sink_printf(source,
+                "\n"
+                "};\n"
+                "\n"
+                "static const size_t %s_size         = %lu;\n"
+                "static const size_t %s_block_size   = %lu;\n"
+                "static const size_t %s_blocks_count = %lu;\n"
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "static %s_data %s_data_struct = {NULL, %lu, 0x%.8lxUL};\n"
+                "\n",
+                var_name, (unsigned long)input->size,
+                var_name, (unsigned long)block_size,
+                var_name, (unsigned long)blocks_count,
+                var_name, var_name, (unsigned long)input->size, checksum);
+
+        write_compressed_accessors(source, var_name, has_stored);
+
+        if(with_verify)
+        {
+            write_crc32c_verify_data(source, var_name, checksum);
+        }
+
+        if(log != NULL)
+        {
+            fprintf(log, "Compressed: %lu byte(s) -> %lu byte(s) (%.1f%%) in %lu block(s) of %lu byte(s)\n",
+                    (unsigned long)input->size, (unsigned long)compressed_size,
+                    100.0 * (double)compressed_size / (double)input->size,
+                    (unsigned long)blocks_count, (unsigned long)block_size);
+        }
+    }
+
+    if(input->stats != NULL)
+    {
+        input->stats->bytes_in += (unsigned long)input->size;
+        input->stats->wall_ms  += now_ms() - started_at;
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    free(blocks);
+
+    return (result != 0 || header->error || source->error) ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+    bin2src_mode mode;
+    const char*  mode_name;
+} ModeInfo;
+
+#define MODES_COUNT 5
+
+static const ModeInfo MODES[MODES_COUNT] =
+{
+      { BIN2SRC_MODE_C_HEADER_SINGLE,        "c_header" }
+
+    , { BIN2SRC_MODE_C_HEADER_SOURCE_EXTERN, "c_extern" }
+    , { BIN2SRC_MODE_C_HEADER_SOURCE_FUNCS,  "c_funcs"  }
+
+    , { BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_EXTERN, "c_struct_extern" }
+    , { BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_FUNC,   "c_struct_func"   }
+};
+
+bin2src_mode bin2src_mode_from_name(const char* name)
+{
+    size_t i = 0;
+    for(; i < MODES_COUNT; ++i)
+    {
+        if( strcmp(name, MODES[i].mode_name) == 0 ) /* name is equal to mode[i].name */
+        {
+            return MODES[i].mode;
+        }
+    }
+
+    /* Undefined mode */
+    return (bin2src_mode)-1;
+}
+
+const char* bin2src_mode_name(bin2src_mode mode)
+{
+    size_t i = 0;
+    for(; i < MODES_COUNT; ++i)
+    {
+        if( mode == MODES[i].mode )
+        {
+            return MODES[i].mode_name;
+        }
+    }
+
+    /* Undefined mode */
+    return NULL;
+}
+
+void bin2src_print_modes(FILE* output)
+{
+    size_t i = 0;
+    for(; i < MODES_COUNT; ++i)
+    {
+        fprintf(output, "\t%s\n", MODES[i].mode_name);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bin2src_input_file(bin2src_input* input, const char* file_name)
+{
+    input->name    = file_name;
+    input->bytes   = NULL;
+    input->read    = NULL;
+    input->context = NULL;
+    input->size    = 0;
+}
+
+void bin2src_input_memory(bin2src_input* input, const void* bytes, size_t size)
+{
+    input->name    = "<memory>";
+    input->bytes   = (const char*) bytes;
+    input->read    = NULL;
+    input->context = NULL;
+    input->size    = size;
+}
+
+void bin2src_input_callback(bin2src_input* input, bin2src_read_func read_func, void* context, size_t size)
+{
+    input->name    = "<callback>";
+    input->bytes   = NULL;
+    input->read    = read_func;
+    input->context = context;
+    input->size    = size;
+}
+
+static size_t read_from_file(void* context, char* buffer, size_t size)
+{
+    return fread(buffer, 1, size, (FILE*) context);
+}
+
+/*
+    Prepares 'input' for the writers: opens files (then '*out_file' must be
+    closed by the caller), and reads the whole input into '*out_buffer'
+    (must be freed by the caller) if 'whole' is set and it isn't in memory.
+*/
+static int open_input(const bin2src_input* input, int whole, InputData* out_input,
+                      FILE** out_file, char** out_buffer)
+{
+    out_input->file_name = input->name;
+    out_input->bytes     = input->bytes;
+    out_input->read      = input->read;
+    out_input->context   = input->context;
+    out_input->size      = input->size;
+    out_input->stats     = NULL;
+
+    *out_file   = NULL;
+    *out_buffer = NULL;
+
+    if(input->bytes == NULL && input->read == NULL)
+    {
+        if(whole)
+        {
+            size_t capacity = 0;
+            if(bin2src_read_file(input->name, out_buffer, &capacity, &out_input->size) != 0)
+            {
+                free(*out_buffer);
+                *out_buffer = NULL;
+                return 1;
+            }
+            out_input->bytes = *out_buffer;
+            return 0;
+        }
+
+        if(open_input_file(input->name, out_file, &out_input->size) != 0)
+        {
+            return 1;
+        }
+        out_input->read    = read_from_file;
+        out_input->context = *out_file;
+        return 0;
+    }
+
+    if(input->size == 0)
+    {
+        fprintf(stderr, "Error: input %s is empty\n", input->name);
+        return 1;
+    }
+
+    if(whole && input->bytes == NULL)
+    {
+        *out_buffer = (char*) malloc(input->size);
+        if(*out_buffer == NULL)
+        {
+            fprintf(stderr, "Error: cannot alocate memory (%lu bytes) to store input %s\n", (unsigned long)input->size, input->name);
+            return 1;
+        }
+
+        if(read_exactly(out_input, *out_buffer, input->size) != 0)
+        {
+            fprintf(stderr, "Error: cannot read the whole input %s\n", input->name);
+
+            free(*out_buffer);
+            *out_buffer = NULL;
+            return 1;
+        }
+        out_input->bytes = *out_buffer;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Packs ('--pack'): many assets in one generated source, laid out by the
+    startup access trace ('--trace'). Assets touched at startup ("hot", in
+    the order of the trace) are packed together into '<pack>_hot', the rest
+    ("cold", in the input order) into '<pack>_cold'. Both arrays start on a
+    page boundary (the hot one is also padded to whole pages), and on ELF
+    targets they go into their own 'bin2src_hot' and 'bin2src_cold'
+    sections, so a lazily paged-in binary faults in only the pages of hot
+    assets at startup. Names don't start with '.rodata.': default linker
+    scripts merge such sections into '.rodata' (which would interleave hot
+    and cold data of different packs), while these stay separate output
+    sections, shared by all packs of the binary.
+
+    The report predicts pages touched by the trace for this layout and for
+    the input order (as if there were no trace).
+*/
+
+#define PACK_ALIGNMENT 16 /* Of each asset in its array */
+
+typedef struct {
+    size_t        size;
+    int           hot;           /* Touched by the trace */
+    size_t        offset;        /* In its array: '<pack>_hot' or '<pack>_cold' */
+    size_t        input_offset;  /* In the input order layout */
+    unsigned long checksum;
+} PackAsset;
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/* Returns the index of the asset, or 'assets_count' if there is no such */
+static size_t find_pack_asset(const bin2src_pack_asset* assets, size_t assets_count, const char* name)
+{
+    size_t i = 0;
+    for(; i < assets_count; ++i)
+    {
+        if(strcmp(assets[i].name, name) == 0) break;
+    }
+    return i;
+}
+
+/*
+    Predicted count of pages touched by the trace, when each asset starts at
+    'offsets[i]' (from a page-aligned start). 'trace_assets' are indices of
+    the assets of trace ranges ('assets_count' - unknown asset). 'pages' is a
+    scratch space of 'pages_count' flags.
+*/
+static size_t count_touched_pages(const bin2src_pack_options* options, const size_t* trace_assets,
+                                  const PackAsset* layout, size_t assets_count, const size_t* offsets,
+                                  unsigned char* pages, size_t pages_count)
+{
+    size_t touched = 0;
+    size_t i = 0;
+
+    memset(pages, 0, pages_count);
+
+    for(i = 0; i < options->trace_count; ++i)
+    {
+        const bin2src_trace_range* range = &options->trace[i];
+        const size_t asset = trace_assets[i];
+        size_t begin = 0;
+        size_t end   = 0;
+        size_t page  = 0;
+
+        if(asset == assets_count || range->offset >= layout[asset].size) continue;
+
+        /* Clamped to the asset, 0 length - up to its end */
+        end = layout[asset].size;
+        if(range->length != 0 && range->length < end - range->offset) end = range->offset + range->length;
+
+        begin = offsets[asset] + range->offset;
+        end   = offsets[asset] + end;
+
+        for(page = begin / options->page_size; page <= (end - 1) / options->page_size; ++page)
+        {
+            if(!pages[page])
+            {
+                pages[page] = 1;
+                ++touched;
+            }
+        }
+    }
+
+    return touched;
+}
+
+/*
+    Writes 'count' zero bytes at 'first_index' of the array. 'in' and 'out'
+    are buffers of PIPELINE_CHUNK_SIZE bytes and its formatted size.
+*/
+static int write_pack_padding(bin2src_sink* sink, const ElementFormat* format,
+                              size_t count, size_t first_index, char* in, char* out)
+{
+    memset(in, 0, (count < PIPELINE_CHUNK_SIZE) ? count : PIPELINE_CHUNK_SIZE);
+
+    while(count > 0)
+    {
+        const size_t size = (count < PIPELINE_CHUNK_SIZE) ? count : PIPELINE_CHUNK_SIZE;
+
+        if(sink_write(sink, out, format_elements(out, in, size, first_index, format)) != 0) return 1;
+
+        first_index += size;
+        count       -= size;
+    }
+
+    return 0;
+}
+
+/* Streams the asset input at 'first_index' of the array, and computes its checksum */
+static int write_pack_asset(bin2src_sink* sink, const ElementFormat* format,
+                            const bin2src_input* asset_input, bin2src_stats* stats,
+                            size_t first_index, char* in, char* out, unsigned long* out_checksum)
+{
+    InputData input;
+    FILE*     input_file   = NULL;
+    char*     input_buffer = NULL;
+    unsigned long crc = CRC32C_INIT;
+    size_t offset = 0;
+    int result = 0;
+    double t = 0.0;
+
+    if(open_input(asset_input, 0, &input, &input_file, &input_buffer) != 0)
+    {
+        return 1;
+    }
+
+    while(offset < input.size)
+    {
+        const size_t size = (input.size - offset < PIPELINE_CHUNK_SIZE) ? input.size - offset : PIPELINE_CHUNK_SIZE;
+        const char* data = in;
+        size_t text_size = 0;
+
+        t = now_ms();
+        if(input.bytes != NULL)
+        {
+            data = input.bytes + offset;
+        }
+        else if(read_exactly(&input, in, size) != 0)
+        {
+            fprintf(stderr, "Error: cannot read the whole file %s (was it changed during conversion?)\n", input.file_name);
+            result = 1;
+            break;
+        }
+        if(stats != NULL) stats->read_ms += now_ms() - t;
+
+        t = now_ms();
+        crc = crc32c_update(crc, data, size);
+        text_size = format_elements(out, data, size, first_index + offset, format);
+        if(stats != NULL) stats->format_ms += now_ms() - t;
+
+        t = now_ms();
+        if(sink_write(sink, out, text_size) != 0)
+        {
+            result = 1;
+            break;
+        }
+        if(stats != NULL)
+        {
+            stats->write_ms  += now_ms() - t;
+            stats->bytes_out += (unsigned long)text_size;
+        }
+
+        offset += size;
+    }
+
+    if(stats != NULL) stats->bytes_in += (unsigned long)offset;
+
+    if(input_file != NULL) fclose(input_file);
+    free(input_buffer);
+
+    *out_checksum = crc32c_final(crc);
+    return result;
+}
+
+/* Writes the '<pack>_hot' or '<pack>_cold' array: assets of 'order', in 'array_size' bytes */
+static int write_pack_array(bin2src_sink* sink, const ElementFormat* format,
+                            const char* var_name, const char* suffix,
+                            const bin2src_pack_asset* assets, PackAsset* layout,
+                            const size_t* order, size_t order_count, size_t array_size,
+                            bin2src_stats* stats, char* in, char* out)
+{
+    size_t index = 0; /* Written bytes */
+    size_t i = 0;
+
+    sink_printf(sink,
+            "static const unsigned char BIN2SRC_PAGE_ALIGNED BIN2SRC_SECTION(\"bin2src_%s\") %s_%s[%lu] = {",
+            suffix, var_name, suffix, (unsigned long)array_size);
+
+    for(i = 0; i < order_count; ++i)
+    {
+        PackAsset* asset = &layout[order[i]];
+
+        if(write_pack_padding(sink, format, asset->offset - index, index, in, out) != 0) return 1;
+        if(write_pack_asset(sink, format, &assets[order[i]].input, stats, asset->offset, in, out, &asset->checksum) != 0) return 1;
+
+        index = asset->offset + asset->size;
+    }
+
+    if(write_pack_padding(sink, format, array_size - index, index, in, out) != 0) return 1;
+
+    sink_printf(sink,
+            "\n"
+            "};\n"
+            "\n");
+
+    return 0;
+}
+
+static int write_pack(
+        bin2src_sink* header, bin2src_sink* source, const char* header_name,
+        const bin2src_pack_asset* assets, size_t assets_count,
+        const bin2src_pack_options* options)
+{
+    const char* var_name = options->var_name;
+
+    ElementFormat format;
+
+    PackAsset* layout       = (PackAsset*) malloc(assets_count * sizeof(PackAsset));
+    size_t*    hot_order    = (size_t*) malloc(assets_count * sizeof(size_t));
+    size_t*    cold_order   = (size_t*) malloc(assets_count * sizeof(size_t));
+    size_t*    offsets      = (size_t*) malloc(assets_count * sizeof(size_t));
+    size_t*    trace_assets = (size_t*) malloc((options->trace_count + 1) * sizeof(size_t));
+    char*      in           = (char*) malloc(PIPELINE_CHUNK_SIZE);
+    char*      out          = (char*) malloc(PIPELINE_FORMATTED_SIZE(PIPELINE_CHUNK_SIZE));
+    unsigned char* pages    = NULL;
+
+    size_t hot_count  = 0;
+    size_t cold_count = 0;
+    size_t hot_size   = 0; /* Padded to whole pages */
+    size_t cold_size  = 0;
+    size_t input_size = 0; /* Of the input order layout */
+    size_t pages_count = 0;
+    size_t i = 0;
+    int result = 0;
+
+    const double started_at = now_ms();
+
+    format.word_size       = 1;
+    format.big_endian      = 0;
+    format.compact         = options->compact;
+    format.max_line_length = options->max_line_length;
+
+    if( layout == NULL || hot_order == NULL || cold_order == NULL || offsets == NULL ||
+        trace_assets == NULL || in == NULL || out == NULL )
+    {
+        fprintf(stderr, "Error: cannot allocate memory for the pack %s\n", var_name);
+        result = 1;
+    }
+
+    /* Sizes (inputs are opened again, to be streamed) */
+    for(i = 0; result == 0 && i < assets_count; ++i)
+    {
+        InputData input;
+        FILE*     input_file   = NULL;
+        char*     input_buffer = NULL;
+
+        if(open_input(&assets[i].input, 0, &input, &input_file, &input_buffer) != 0)
+        {
+            result = 1;
+            break;
+        }
+        if(input_file != NULL) fclose(input_file);
+        free(input_buffer);
+
+        layout[i].size     = input.size;
+        layout[i].hot      = 0;
+        layout[i].checksum = 0;
+
+        layout[i].input_offset = align_up(input_size, PACK_ALIGNMENT);
+        input_size = layout[i].input_offset + input.size;
+    }
+
+    /* Hot assets, in the order of their first appearance in the trace */
+    for(i = 0; result == 0 && i < options->trace_count; ++i)
+    {
+        const size_t asset = find_pack_asset(assets, assets_count, options->trace[i].asset_name);
+        trace_assets[i] = asset;
+
+        if(asset == assets_count)
+        {
+            fprintf(stderr, "Warning: trace of %s: unknown asset %s, skipped\n", var_name, options->trace[i].asset_name);
+        }
+        else if(!layout[asset].hot)
+        {
+            layout[asset].hot = 1;
+            hot_order[hot_count++] = asset;
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    if(result == 0)
+    {
+        size_t touched_before = 0;
+        size_t touched_after  = 0;
+
+        for(i = 0; i < hot_count; ++i)
+        {
+            PackAsset* asset = &layout[hot_order[i]];
+
+            asset->offset = align_up(hot_size, PACK_ALIGNMENT);
+            hot_size = asset->offset + asset->size;
+        }
+        hot_size = align_up(hot_size, options->page_size);
+
+        for(i = 0; i < assets_count; ++i)
+        {
+            if(layout[i].hot) continue;
+
+            layout[i].offset = align_up(cold_size, PACK_ALIGNMENT);
+            cold_size = layout[i].offset + layout[i].size;
+            cold_order[cold_count++] = i;
+        }
+
+        /* Predicted pages: in the input order, and in this layout (the cold array follows the hot one) */
+        pages_count = ((input_size > hot_size + cold_size) ? input_size : hot_size + cold_size) / options->page_size + 1;
+        pages = (unsigned char*) malloc(pages_count);
+        if(pages == NULL)
+        {
+            fprintf(stderr, "Error: cannot allocate memory for the pack %s\n", var_name);
+            result = 1;
+        }
+        else
+        {
+            for(i = 0; i < assets_count; ++i) offsets[i] = layout[i].input_offset;
+            touched_before = count_touched_pages(options, trace_assets, layout, assets_count, offsets, pages, pages_count);
+
+            for(i = 0; i < assets_count; ++i) offsets[i] = layout[i].offset + (layout[i].hot ? 0 : hot_size);
+            touched_after = count_touched_pages(options, trace_assets, layout, assets_count, offsets, pages, pages_count);
+
+            if(options->log != NULL)
+            {
+                fprintf(options->log, "Pack %s: %lu hot asset(s) in %lu byte(s), %lu cold asset(s) in %lu byte(s)\n",
+                        var_name, (unsigned long)hot_count, (unsigned long)hot_size,
+                        (unsigned long)cold_count, (unsigned long)cold_size);
+                if(options->trace_count > 0)
+                {
+                    fprintf(options->log, "Pages touched by the trace: %lu in the input order -> %lu (of %lu byte(s))\n",
+                            (unsigned long)touched_before, (unsigned long)touched_after, (unsigned long)options->page_size);
+                }
+            }
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    if(result == 0)
+    {
+        sink_printf(header,
+                "#pragma once\n"
+                "\n"
+                "#include <stddef.h> /* for size_t */\n"
+                "\n"
+                "#ifdef __cplusplus\n"
+                "extern \"C\" {\n"
+                "#endif\n"
+                "\n");
+
+        sink_printf(header,
+                "typedef struct %s_asset\n"
+                "{\n"
+                "    const char*          name;\n"
+                "    const unsigned char* bytes;\n"
+                "    size_t               size;\n"
+                "    unsigned long        crc32c;\n"
+                "} %s_asset;\n"
+                "\n",
+                var_name, var_name);
+
+        sink_printf(header,
+                "/* Assets, in the input order */\n"
+                "const %s_asset* get_%s_assets();\n"
+                "size_t get_%s_assets_count();\n"
+                "\n"
+                "/* Returns NULL if there is no asset with the name */\n"
+                "const %s_asset* find_%s_asset(const char* name);\n",
+                var_name, var_name, var_name, var_name, var_name);
+
+        sink_printf(header,
+                "\n"
+                "#ifdef __cplusplus\n"
+                "} /* extern \"C\" */\n"
+                "#endif\n");
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    if(result == 0)
+    {
+        sink_printf(source,
+                "#include \"%s\"\n"
+                "\n"
+                "#include <string.h> /* for strcmp() */\n"
+                "\n"
+                "/*\n"
+                "    Assets touched at startup are packed into '%s_hot', the rest into\n"
+                "    '%s_cold'. Both start on a page boundary, in 'bin2src_hot' and 'bin2src_cold'\n"
+                "    sections on ELF (kept apart from '.rodata' by default linker scripts).\n"
+                "*/\n",
+                header_name, var_name, var_name);
+
+        sink_printf(source,
+                "#if defined(__GNUC__)\n"
+                "    #define BIN2SRC_PAGE_ALIGNED __attribute__((aligned(%lu)))\n"
+                "#elif defined(_MSC_VER)\n"
+                "    #define BIN2SRC_PAGE_ALIGNED __declspec(align(%lu))\n"
+                "#else\n"
+                "    #define BIN2SRC_PAGE_ALIGNED /* Unknown compiler: arrays may share pages */\n"
+                "#endif\n"
+                "\n",
+                (unsigned long)options->page_size, (unsigned long)options->page_size);
+
+        sink_printf(source,
+                "#if defined(__GNUC__) && defined(__ELF__)\n"
+                "    #define BIN2SRC_SECTION(name) __attribute__((section(name)))\n"
+                "#else\n"
+                "    #define BIN2SRC_SECTION(name)\n"
+                "#endif\n"
+                "\n");
+
+        if(hot_count > 0)
+        {
+            result = write_pack_array(source, &format, var_name, "hot", assets, layout, hot_order, hot_count, hot_size, options->stats, in, out);
+        }
+        if(result == 0 && cold_count > 0)
+        {
+            result = write_pack_array(source, &format, var_name, "cold", assets, layout, cold_order, cold_count, cold_size, options->stats, in, out);
+        }
+    }
+
+    if(result == 0)
+    {
+        sink_printf(source,
+                "#undef BIN2SRC_PAGE_ALIGNED\n"
+                "#undef BIN2SRC_SECTION\n"
+                "\n"
+                "/* ------------------------------------------------------ */\n"
+                "\n"
+                "static const %s_asset %s_assets[%lu] = {",
+                var_name, var_name, (unsigned long)assets_count);
+
+        for(i = 0; i < assets_count; ++i)
+        {
+            sink_printf(source, "%s\n\t{\"%s\", %s_%s + %lu, %lu, 0x%.8lxUL}",
+                    (i == 0) ? "" : ",",
+                    assets[i].name, var_name, layout[i].hot ? "hot" : "cold",
+                    (unsigned long)layout[i].offset, (unsigned long)layout[i].size, layout[i].checksum);
+        }
+
+        sink_printf(source,
+                "\n"
+                "};\n"
+                "\n"
+                "const %s_asset* get_%s_assets() { return %s_assets; }\n"
+                "size_t get_%s_assets_count() { return %lu; }\n"
+                "\n",
+                var_name, var_name, var_name,
+                var_name, (unsigned long)assets_count);
+
+        sink_printf(source,
+                "const %s_asset* find_%s_asset(const char* name)\n"
+                "{\n"
+                "    size_t i = 0;\n"
+                "    for(; i < %lu; ++i)\n"
+                "    {\n"
+                "        if(strcmp(%s_assets[i].name, name) == 0) return &%s_assets[i];\n"
+                "    }\n"
+                "    return NULL;\n"
+                "}\n",
+                var_name, var_name, (unsigned long)assets_count, var_name, var_name);
+    }
+
+    if(options->stats != NULL)
+    {
+        options->stats->wall_ms += now_ms() - started_at;
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    free(layout);
+    free(hot_order);
+    free(cold_order);
+    free(offsets);
+    free(trace_assets);
+    free(in);
+    free(out);
+    free(pages);
+
+    return (result != 0 || header->error || source->error) ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Returns the file name part of 'path'. The '.c' includes its header by
+    this name: they are written next to each other, and the include (so the
+    output too) doesn't depend on the directory they were generated into.
+*/
+static const char* path_base_name(const char* path)
+{
+    const char* base_name = path;
+
+    for(; *path != '\0'; ++path)
+    {
+#if defined(_WIN32)
+        if(*path == '\\') base_name = path + 1;
+#endif
+        if(*path == '/') base_name = path + 1;
+    }
+
+    return base_name;
+}
+
+/* Writes generated code of 'job' into sinks, see convert_into_files() */
+typedef int (*ConvertJob)(const void* job, const char* header_file_name,
+                          bin2src_sink* header, bin2src_sink* source);
+
+/*
+    Returns newly allocated name of the temporary file, that is renamed
+    into 'file_name' once complete. Unique per process on POSIX, so
+    concurrent jobs don't clash.
+*/
+static char* temp_file_name(const char* file_name)
+{
+    char suffix[32];
+
+#if defined(BIN2SRC_POSIX)
+    sprintf(suffix, ".tmp.%lu", (unsigned long)getpid());
+#else
+    strcpy(suffix, ".tmp");
+#endif
+
+    return str_concat(file_name, suffix);
+}
+
+/* Replaces 'file_name' with the complete temporary file. Returns 0 on success */
+static int replace_file(const char* temp_name, const char* file_name)
+{
+#if !defined(BIN2SRC_POSIX)
+    remove(file_name); /* rename() may refuse to replace it (e.g. on Windows) */
+#endif
+
+    if(rename(temp_name, file_name) != 0)
+    {
+        fprintf(stderr, "Error: can\'t rename the file %s into %s\n", temp_name, file_name);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    Writes '<output_file_name>.h' (and '.c' if 'with_source') by running
+    'convert' with their sinks. Outputs are written under temporary names
+    and renamed into place once complete, so existing outputs are replaced,
+    never modified in-place: they may be hard links (e.g. into an output
+    cache, shared by other build trees). Doesn't leave partial outputs on
+    error, which would look up-to-date for build systems.
+*/
+static int convert_into_files(const char* output_file_name, int with_source,
+                              ConvertJob convert, const void* job)
+{
+    char* header_file_name = NULL;
+    char* source_file_name = NULL;
+    char* header_temp_name = NULL;
+    char* source_temp_name = NULL;
+
+    FILE* header_file = NULL;
+    FILE* source_file = NULL;
+
+    bin2src_sink header;
+    bin2src_sink source;
+
+    int result = 1;
+
+    header_file_name = str_concat(output_file_name, ".h");
+    source_file_name = str_concat(output_file_name, ".c");
+    header_temp_name = (header_file_name != NULL) ? temp_file_name(header_file_name) : NULL;
+    source_temp_name = (source_file_name != NULL) ? temp_file_name(source_file_name) : NULL;
+    if(header_temp_name == NULL || source_temp_name == NULL)
+    {
+        free(header_file_name);
+        free(source_file_name);
+        free(header_temp_name);
+        free(source_temp_name);
+        return 1;
+    }
+
+    header_file = fopen(header_temp_name, "w");
+    if(header_file == NULL)
+    {
+        fprintf(stderr, "Error: can\'t open the file %s\n", header_file_name);
+    }
+    else if(with_source && (source_file = fopen(source_temp_name, "w")) == NULL)
+    {
+        fprintf(stderr, "Error: can\'t open the file %s\n", source_file_name);
+    }
+    else
+    {
+        bin2src_sink_file(&header, header_file);
+        bin2src_sink_file(&source, source_file);
+
+        result = convert(job, header_file_name, &header, with_source ? &source : NULL);
+    }
+
+    if(header_file != NULL && fclose(header_file) != 0) result = 1;
+    if(source_file != NULL && fclose(source_file) != 0) result = 1;
+
+    if(result == 0)
+    {
+        result = replace_file(header_temp_name, header_file_name);
+        if(result == 0 && with_source)
+        {
+            result = replace_file(source_temp_name, source_file_name);
+        }
+    }
+
+    if(result != 0)
+    {
+        if(header_file != NULL) remove(header_temp_name);
+        if(source_file != NULL) remove(source_temp_name);
+    }
+
+    free(header_file_name);
+    free(source_file_name);
+    free(header_temp_name);
+    free(source_temp_name);
+
+    return result;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bin2src_options_init(bin2src_options* options)
+{
+    options->mode             = BIN2SRC_MODE_C_HEADER_SINGLE;
+    options->var_name         = NULL;
+    options->header_name      = NULL;
+    options->with_verify      = 0;
+    options->word_size        = 1;
+    options->big_endian       = 0;
+    options->base             = NULL;
+    options->base_var_name    = NULL;
+    options->block_size       = 0;
+    options->threads          = 0;
+    options->blocks_in_flight = 0;
+    options->compact          = 0;
+    options->max_line_length  = BIN2SRC_MAX_LINE_LENGTH;
+    options->stats            = NULL;
+    options->log              = NULL;
+}
+
+int bin2src_convert(const bin2src_input* input, const bin2src_options* options,
+                    bin2src_sink* header, bin2src_sink* source)
+{
+    const char* var_name = options->var_name;
+
+    InputData input_data;
+    FILE*     input_file   = NULL;
+    char*     input_buffer = NULL;
+
+    InputData base_data;
+    FILE*     base_file   = NULL;
+    char*     base_buffer = NULL;
+
+    ElementFormat format;
+    char* header_name = NULL;
+    int result = -1;
+
+    /* Options validation */
+    if( (var_name == NULL) || (bin2src_check_var_name(var_name, strlen(var_name)) != 0) )
+    {
+        fprintf(stderr, "Error: invalid var name %s\n", (var_name != NULL) ? var_name : "(null)");
+        return 1;
+    }
+
+    if(bin2src_mode_name(options->mode) == NULL)
+    {
+        fprintf(stderr, "Error: invalid mode %i\n", (int)options->mode);
+        return 1;
+    }
+
+    if( (options->word_size != 1) && (options->word_size != 2) && (options->word_size != 4) && (options->word_size != 8) )
+    {
+        fprintf(stderr, "Error: invalid word size %lu (expected 1, 2, 4 or 8)\n", (unsigned long)options->word_size);
+        return 1;
+    }
+
+    if(options->mode != BIN2SRC_MODE_C_HEADER_SINGLE && source == NULL)
+    {
+        fprintf(stderr, "Error: mode %s requires the source sink\n", bin2src_mode_name(options->mode));
+        return 1;
+    }
+
+    if(options->base != NULL)
+    {
+        if(options->mode != BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_FUNC)
+        {
+            fprintf(stderr, "Error: delta encoding (--base) requires 'c_struct_func' mode (%s)\n", var_name);
+            return 1;
+        }
+
+        if(options->word_size != 1)
+        {
+            fprintf(stderr, "Error: delta encoding (--base) supports only '--word-size 1' (%s)\n", var_name);
+            return 1;
+        }
+
+        if( (options->base_var_name == NULL) || (bin2src_check_var_name(options->base_var_name, strlen(options->base_var_name)) != 0) )
+        {
+            fprintf(stderr, "Error: invalid base var name %s\n", (options->base_var_name != NULL) ? options->base_var_name : "(null)");
+            return 1;
+        }
+    }
+
+    if(options->compact && options->max_line_length < BIN2SRC_MIN_LINE_LENGTH)
+    {
+        fprintf(stderr, "Error: invalid max line length %lu (expected at least %i)\n",
+                (unsigned long)options->max_line_length, BIN2SRC_MIN_LINE_LENGTH);
+        return 1;
+    }
+
+    if(options->block_size != 0)
+    {
+        if(options->mode != BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_FUNC)
+        {
+            fprintf(stderr, "Error: compression (--compress) requires 'c_struct_func' mode (%s)\n", var_name);
+            return 1;
+        }
+
+        if( (options->word_size != 1) || (options->base != NULL) )
+        {
+            fprintf(stderr, "Error: compression (--compress) doesn't support '--word-size' and '--base' (%s)\n", var_name);
+            return 1;
+        }
+    }
+
+    format.word_size       = options->word_size;
+    format.big_endian      = options->big_endian;
+    format.compact         = options->compact;
+    format.max_line_length = options->max_line_length;
+
+    if(options->header_name == NULL && options->mode != BIN2SRC_MODE_C_HEADER_SINGLE)
+    {
+        header_name = str_concat(var_name, ".h");
+        if(header_name == NULL) return 1;
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    /* Delta needs the whole input, otherwise it is streamed through the read/format/write pipeline */
+    if(options->base != NULL)
+    {
+        if(open_input(options->base, 1, &base_data, &base_file, &base_buffer) != 0)
+        {
+            free(header_name);
+            return 1;
+        }
+    }
+
+    if(open_input(input, options->base != NULL, &input_data, &input_file, &input_buffer) != 0)
+    {
+        free(base_buffer);
+        free(header_name);
+        return 1;
+    }
+    input_data.stats = options->stats;
+
+    switch (options->mode) {
+    case BIN2SRC_MODE_C_HEADER_SINGLE: {
+        result = write_C_header_single(header, var_name, &input_data, &format, options->with_verify);
+    } break;
+
+    case BIN2SRC_MODE_C_HEADER_SOURCE_EXTERN: {
+        result = write_C_header_source_extern(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                              var_name, &input_data, &format, options->with_verify);
+    } break;
+
+    case BIN2SRC_MODE_C_HEADER_SOURCE_FUNCS: {
+        result = write_C_header_source_funcs(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                             var_name, &input_data, &format, options->with_verify);
+    } break;
+
+    case BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_EXTERN: {
+        result = write_C_header_source_struct_extern(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                                     var_name, &input_data, &format, options->with_verify);
+    } break;
+
+    case BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_FUNC: {
+        if(options->base != NULL)
+        {
+            result = write_C_header_source_struct_delta(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                                        var_name, input_data.bytes, input_data.size,
+                                                        options->base_var_name, base_data.bytes, base_data.size,
+                                                        &format, options->with_verify, options->log);
+        }
+        else if(options->block_size != 0)
+        {
+            result = write_C_header_source_struct_compressed(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                                             var_name, &input_data, &format,
+                                                             options->block_size, options->threads, options->blocks_in_flight,
+                                                             options->with_verify, options->log);
+        }
+        else
+        {
+            result = write_C_header_source_struct_func(header, source, (header_name != NULL) ? header_name : options->header_name,
+                                                       var_name, &input_data, &format, options->with_verify);
+        }
+    } break;
+
+    default: { /* Unreachable: mode validated previously */ } break;
+    }
+
+    if(input_file != NULL) fclose(input_file);
+    free(input_buffer);
+    free(base_buffer);
+    free(header_name);
+
+    return (result != 0) ? 1 : 0;
+}
+
+typedef struct {
+    const bin2src_input*   input;
+    const bin2src_options* options;
+} ConvertFileJob;
+
+static int convert_file_job(const void* job, const char* header_file_name,
+                            bin2src_sink* header, bin2src_sink* source)
+{
+    const ConvertFileJob* file_job = (const ConvertFileJob*) job;
+    bin2src_options options = *file_job->options;
+
+    if(options.header_name == NULL)
+    {
+        options.header_name = path_base_name(header_file_name);
+    }
+
+    return bin2src_convert(file_job->input, &options, header, source);
+}
+
+int bin2src_convert_to_files(const bin2src_input* input, const bin2src_options* options,
+                             const char* output_file_name)
+{
+    ConvertFileJob job;
+    job.input   = input;
+    job.options = options;
+
+    return convert_into_files(output_file_name, options->mode != BIN2SRC_MODE_C_HEADER_SINGLE,
+                              convert_file_job, &job);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bin2src_pack_options_init(bin2src_pack_options* options)
+{
+    options->var_name        = NULL;
+    options->header_name     = NULL;
+    options->trace           = NULL;
+    options->trace_count     = 0;
+    options->page_size       = 4096;
+    options->compact         = 0;
+    options->max_line_length = BIN2SRC_MAX_LINE_LENGTH;
+    options->stats           = NULL;
+    options->log             = NULL;
+}
+
+int bin2src_pack(const bin2src_pack_asset* assets, size_t assets_count,
+                 const bin2src_pack_options* options,
+                 bin2src_sink* header, bin2src_sink* source)
+{
+    const char* var_name = options->var_name;
+    char* header_name = NULL;
+    size_t i = 0;
+    int result = 0;
+
+    /* Options validation */
+    if( (var_name == NULL) || (bin2src_check_var_name(var_name, strlen(var_name)) != 0) )
+    {
+        fprintf(stderr, "Error: invalid var name %s\n", (var_name != NULL) ? var_name : "(null)");
+        return 1;
+    }
+
+    if(assets_count == 0)
+    {
+        fprintf(stderr, "Error: pack %s has no assets\n", var_name);
+        return 1;
+    }
+
+    for(i = 0; i < assets_count; ++i)
+    {
+        const char* name = assets[i].name;
+
+        if( (name == NULL) || (bin2src_check_var_name(name, strlen(name)) != 0) )
+        {
+            fprintf(stderr, "Error: invalid asset name %s in pack %s\n", (name != NULL) ? name : "(null)", var_name);
+            return 1;
+        }
+
+        if(find_pack_asset(assets, i, name) != i)
+        {
+            fprintf(stderr, "Error: duplicate asset name %s in pack %s\n", name, var_name);
+            return 1;
+        }
+    }
+
+    /* Power of 2: supported by alignment attributes */
+    if( (options->page_size < PACK_ALIGNMENT) || ((options->page_size & (options->page_size - 1)) != 0) )
+    {
+        fprintf(stderr, "Error: invalid page size %lu (expected a power of 2, at least %i)\n",
+                (unsigned long)options->page_size, PACK_ALIGNMENT);
+        return 1;
+    }
+
+    if(options->compact && options->max_line_length < BIN2SRC_MIN_LINE_LENGTH)
+    {
+        fprintf(stderr, "Error: invalid max line length %lu (expected at least %i)\n",
+                (unsigned long)options->max_line_length, BIN2SRC_MIN_LINE_LENGTH);
+        return 1;
+    }
+
+    if(options->trace_count > 0 && options->trace == NULL)
+    {
+        fprintf(stderr, "Error: missing trace of pack %s\n", var_name);
+        return 1;
+    }
+
+    if(source == NULL)
+    {
+        fprintf(stderr, "Error: pack %s requires the source sink\n", var_name);
+        return 1;
+    }
+
+    if(options->header_name == NULL)
+    {
+        header_name = str_concat(var_name, ".h");
+        if(header_name == NULL) return 1;
+    }
+
+    result = write_pack(header, source, (header_name != NULL) ? header_name : options->header_name,
+                        assets, assets_count, options);
+
+    free(header_name);
+
+    return (result != 0) ? 1 : 0;
+}
+
+typedef struct {
+    const bin2src_pack_asset*   assets;
+    size_t                      assets_count;
+    const bin2src_pack_options* options;
+} PackFileJob;
+
+static int pack_file_job(const void* job, const char* header_file_name,
+                         bin2src_sink* header, bin2src_sink* source)
+{
+    const PackFileJob* file_job = (const PackFileJob*) job;
+    bin2src_pack_options options = *file_job->options;
+
+    if(options.header_name == NULL)
+    {
+        options.header_name = path_base_name(header_file_name);
+    }
+
+    return bin2src_pack(file_job->assets, file_job->assets_count, &options, header, source);
+}
+
+int bin2src_pack_to_files(const bin2src_pack_asset* assets, size_t assets_count,
+                          const bin2src_pack_options* options,
+                          const char* output_file_name)
+{
+    PackFileJob job;
+    job.assets       = assets;
+    job.assets_count = assets_count;
+    job.options      = options;
+
+    return convert_into_files(output_file_name, 1, pack_file_job, &job);
+}
@@ -0,0 +1,293 @@
+#ifndef BIN2SRC_H
+#define BIN2SRC_H
+
+/*
+    libbin2src - the conversion engine of 'bin2src', as a library.
+
+    Lets build drivers and code generators convert assets in-process,
+    instead of spawning the 'bin2src' executable for every asset:
+
+        bin2src_input   input;
+        bin2src_options options;
+        bin2src_sink    header;
+        bin2src_buffer  header_text = { NULL, 0, 0 };
+
+        bin2src_input_memory(&input, bytes, bytes_count);
+
+        bin2src_options_init(&options);
+        options.var_name = "icon";
+
+        bin2src_sink_buffer(&header, &header_text);
+
+        if(bin2src_convert(&input, &options, &header, NULL) == 0) {
+            ... header_text.data, header_text.size ...
+        }
+        free(header_text.data);
+
+    All functions return 0 on success and non-0 on error (the error is
+    described on stderr), unless stated otherwise. Conversions don't share
+    any state, so they may run concurrently (in different threads). Only
+    in builds without pthreads and Win32 (or with BIN2SRC_NO_THREADS), call
+    bin2src_crc32c() once before that: it fills the checksum tables.
+
+    Written in C89, same as the 'bin2src' executable.
+*/
+
+#include <stddef.h> /* size_t */
+#include <stdio.h>  /* FILE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BIN2SRC_VERSION "1.1.0"
+
+/*
+    Default limit of compact lines: the minimum logical source line length,
+    which C99 compilers must accept. Lines are broken between elements, so
+    shorter limits only cost a few bytes.
+*/
+#define BIN2SRC_MAX_LINE_LENGTH 4095
+#define BIN2SRC_MIN_LINE_LENGTH 32
+
+/* -------------------------------------------------------------------------- */
+
+/* Layout of generated code, see README.md for examples */
+typedef enum {
+      BIN2SRC_MODE_C_HEADER_SINGLE = 0          /* 'c_header'        - '.h' only */
+    , BIN2SRC_MODE_C_HEADER_SOURCE_EXTERN       /* 'c_extern'        - '.h' + '.c' */
+    , BIN2SRC_MODE_C_HEADER_SOURCE_FUNCS        /* 'c_funcs'         - '.h' + '.c' */
+    , BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_EXTERN /* 'c_struct_extern' - '.h' + '.c' */
+    , BIN2SRC_MODE_C_HEADER_SOURCE_STRUCT_FUNC  /* 'c_struct_func'   - '.h' + '.c' */
+} bin2src_mode;
+
+/* Returns -1 in case of missmatch */
+bin2src_mode bin2src_mode_from_name(const char* name);
+
+/* Returns NULL in case of missmatch */
+const char* bin2src_mode_name(bin2src_mode mode);
+
+/* Prints the names of all modes, one per line */
+void bin2src_print_modes(FILE* output);
+
+/* Returns 0 if 'name' (of 'name_len' characters) is a valid C identifier */
+int bin2src_check_var_name(const char* name, size_t name_len);
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Read callback: reads up to 'size' next input bytes into 'buffer'.
+    Returns the number of read bytes, which is less than 'size' only at
+    the end of input, or on error.
+*/
+typedef size_t (*bin2src_read_func)(void* context, char* buffer, size_t size);
+
+/* Input, set up by one of bin2src_input_*() */
+typedef struct {
+    const char*       name;    /* File name, or a name for error messages */
+    const char*       bytes;   /* Whole input in memory, or NULL */
+    bin2src_read_func read;    /* Read callback, or NULL */
+    void*             context; /* Passed to 'read' */
+    size_t            size;    /* Exact input size (determined on open for files) */
+} bin2src_input;
+
+/* Input from the file, opened (and closed) by the conversion itself */
+void bin2src_input_file(bin2src_input* input, const char* file_name);
+
+/* Input from memory: 'bytes' must stay valid during the conversion */
+void bin2src_input_memory(bin2src_input* input, const void* bytes, size_t size);
+
+/*
+    Input from the read callback. The size must be known upfront, since
+    generated code starts with the array size. Input is streamed, unless
+    the whole of it is needed (e.g. for delta encoding).
+*/
+void bin2src_input_callback(bin2src_input* input, bin2src_read_func read_func, void* context, size_t size);
+
+/*
+    Reads the whole file into '*buffer', reusing it when '*buffer_capacity'
+    is large enough, and growing (realloc) it otherwise. This lets long
+    running callers keep a warm buffer between conversions.
+    Attention: you must free the allocated buffer manually
+*/
+int bin2src_read_file(const char* file_name, char** buffer, size_t* buffer_capacity, size_t* out_file_size);
+
+/* CRC32C (Castagnoli) of the bytes, same as emitted as '<name>_crc32c' */
+unsigned long bin2src_crc32c(const char* bytes, size_t bytes_count);
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct bin2src_sink bin2src_sink;
+
+/* Write callback: returns 0 on success, non-0 on error */
+typedef int (*bin2src_write_func)(bin2src_sink* sink, const char* data, size_t size);
+
+/*
+    Output sink, receives generated code, set up by one of bin2src_sink_*().
+    Attention: 'write' may be called from a thread, other than the thread
+    of the conversion (but never concurrently for the same sink).
+*/
+struct bin2src_sink {
+    bin2src_write_func write;
+    void*              context; /* FILE*, bin2src_buffer* or user data */
+    int                fd;      /* For bin2src_sink_fd() */
+    int                error;   /* Set, when 'write' fails (later writes are skipped) */
+};
+
+/* Growing memory buffer, for bin2src_sink_buffer() */
+typedef struct {
+    char*  data; /* Not null-terminated, you must free it manually */
+    size_t size;
+    size_t capacity;
+} bin2src_buffer;
+
+/* Writes into the file, opened for writing. It isn't closed */
+void bin2src_sink_file(bin2src_sink* sink, FILE* file);
+
+/* Writes into the file descriptor (POSIX and Windows). It isn't closed */
+void bin2src_sink_fd(bin2src_sink* sink, int fd);
+
+/* Appends to the buffer, growing it with realloc() */
+void bin2src_sink_buffer(bin2src_sink* sink, bin2src_buffer* buffer);
+
+/* Writes through the user callback */
+void bin2src_sink_callback(bin2src_sink* sink, bin2src_write_func write_func, void* context);
+
+/* -------------------------------------------------------------------------- */
+
+/* Busy time of each stage, accumulated over all conversions */
+typedef struct {
+    double        read_ms;
+    double        format_ms;
+    double        write_ms;
+    double        wall_ms;
+    unsigned long bytes_in;
+    unsigned long bytes_out;
+} bin2src_stats;
+
+/* Prints throughput and utilisation (busy / wall time) of each stage */
+void bin2src_print_stats(FILE* output, const bin2src_stats* stats);
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+    bin2src_mode mode;
+    const char*  var_name;    /* Must be a valid C identifier */
+    const char*  header_name; /* For '#include "<header_name>"' in the '.c', NULL - "<var_name>.h" */
+
+    int          with_verify; /* Also generate 'verify_<name>_crc32c()' */
+
+    size_t       word_size;   /* Array elements: 1 (bytes), 2, 4 or 8 byte words */
+    int          big_endian;  /* Byte order of the target, for words */
+
+    /*
+        Delta encoding: the input is described as a difference against the
+        'base', which is embedded (as 'base_var_name') in 'c_struct_func'
+        mode. NULL - disabled. Requires 'c_struct_func' mode and bytes.
+    */
+    const bin2src_input* base;
+    const char*          base_var_name;
+
+    /*
+        Seekable compression: the input is compressed in blocks of
+        'block_size' bytes, which 'read_<name>()' decompresses on demand.
+        0 - disabled. Requires 'c_struct_func' mode and bytes, without base.
+    */
+    size_t block_size;
+
+    /*
+        Compression runs on 'threads' threads (0 - one per CPU), with at most
+        'blocks_in_flight' blocks in memory (0 - two per thread). Output
+        doesn't depend on them.
+    */
+    size_t threads;
+    size_t blocks_in_flight;
+
+    /*
+        Compact format: decimal bytes (hex words) without spaces or leading
+        zeros, in lines of up to 'max_line_length' characters. About 3.6
+        characters per byte, instead of 6.2.
+    */
+    int    compact;
+    size_t max_line_length;
+
+    bin2src_stats* stats; /* NULL - don't collect */
+    FILE*          log;   /* Informational messages (like delta summary), NULL - quiet */
+} bin2src_options;
+
+/* Default options: 'c_header' mode, bytes, no verify/delta/compression/compact/stats/log */
+void bin2src_options_init(bin2src_options* options);
+
+/*
+    Converts the input into generated code, written into the 'header' sink
+    and (for all modes, except 'c_header') into the 'source' sink.
+*/
+int bin2src_convert(const bin2src_input* input, const bin2src_options* options,
+                    bin2src_sink* header, bin2src_sink* source);
+
+/*
+    Converts the input into '<output_file_name>.h' (and '.c') files. Missing
+    'options->header_name' means the file name of '<output_file_name>.h',
+    without directories. Existing files are replaced (via rename()), never
+    modified in-place.
+*/
+int bin2src_convert_to_files(const bin2src_input* input, const bin2src_options* options,
+                             const char* output_file_name);
+
+/* -------------------------------------------------------------------------- */
+
+/* Asset of a pack */
+typedef struct {
+    const char*   name;  /* Must be a valid C identifier, unique in the pack */
+    bin2src_input input;
+} bin2src_pack_asset;
+
+/* Range of the startup access trace: 'length' bytes at 'offset' of the asset, 0 - up to its end */
+typedef struct {
+    const char* asset_name;
+    size_t      offset;
+    size_t      length;
+} bin2src_trace_range;
+
+typedef struct {
+    const char* var_name;    /* Name of the pack, must be a valid C identifier */
+    const char* header_name; /* For '#include "<header_name>"' in the '.c', NULL - "<var_name>.h" */
+
+    /*
+        Ranges, touched at startup (in the order of access). Their assets are
+        packed together, before the rest, with a page-aligned boundary.
+        NULL - no trace, assets are packed in the input order.
+    */
+    const bin2src_trace_range* trace;
+    size_t                     trace_count;
+    size_t                     page_size;   /* Power of 2 */
+
+    int    compact;         /* Same as in bin2src_options */
+    size_t max_line_length;
+
+    bin2src_stats* stats; /* NULL - don't collect */
+    FILE*          log;   /* Layout summary and predicted pages touched, NULL - quiet */
+} bin2src_pack_options;
+
+/* Default options: no trace, 4 KiB pages, no stats/log */
+void bin2src_pack_options_init(bin2src_pack_options* options);
+
+/*
+    Packs assets into one array (two: hot and cold, with a trace) and the
+    '<var_name>_asset' table, with 'get_<var_name>_assets()' and
+    'find_<var_name>_asset(name)' accessors.
+*/
+int bin2src_pack(const bin2src_pack_asset* assets, size_t assets_count,
+                 const bin2src_pack_options* options,
+                 bin2src_sink* header, bin2src_sink* source);
+
+/* Packs assets into '<output_file_name>.h' and '.c' files, same as bin2src_convert_to_files() */
+int bin2src_pack_to_files(const bin2src_pack_asset* assets, size_t assets_count,
+                          const bin2src_pack_options* options,
+                          const char* output_file_name);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* BIN2SRC_H */
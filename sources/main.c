@@ -1,10 +1,41 @@
-#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE */
+#if defined(__unix__) || defined(__APPLE__)
+    /* Must be defined before any system header, since we build with '-ansi' */
+    #define _POSIX_C_SOURCE 200112L
+    #define BIN2SRC_POSIX
+#endif
+
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, strtoul() */
+#include <limits.h> /* ULONG_MAX, INT_MAX */
 #include <stdio.h>  /* fprintf(), fopen(), fclose() */
 #include <string.h> /* strlen(), strcmp(), strcat(), etc */
+#include <time.h>   /* clock(), clock_gettime() */
+
+#if defined(__linux__)
+    #include <sys/inotify.h> /* inotify_init(), inotify_add_watch() for '--watch' */
+    #include <poll.h>        /* poll() */
+    #include <unistd.h>      /* read(), close() */
+    #include <errno.h>       /* errno, EINTR */
+    #include <sys/ioctl.h>   /* ioctl() for reflinks in '--cache' */
+    #include <linux/fs.h>    /* FICLONE */
+#endif
+
+#if defined(BIN2SRC_POSIX)
+    #include <sys/types.h>   /* off_t, time_t */
+    #include <sys/stat.h>    /* stat() for '--cache' */
+    #include <dirent.h>      /* opendir(), readdir() */
+    #include <fcntl.h>       /* open() */
+    #include <unistd.h>      /* unlink(), getpid() */
+    #include <utime.h>       /* utime() */
+#endif
 
 #include <parg.h>   /* parg library */
 
+#include "bin2src.h" /* Conversion engine (libbin2src) */
+
 /*
+    Command line interface of 'bin2src': arguments parsing, manifests,
+    '--watch' and '--cache'. Conversions are done by libbin2src.
+
     Portability notes:
       - In 'fprintf()' instead of '%zu' (for 'size_t' type) used '%lu' with
         '(unsigned long)' cast - since '%zu' was added in 'C99', but for
@@ -14,719 +45,1346 @@
 
 /* -------------------------------------------------------------------------- */
 
-int is_digit(char ch)
-{
-    return (ch >= '0' && ch <= '9');
-}
+/*
+    'str_concat()', 'path_base_name()' and 'now_ms()' mirror the static
+    helpers of 'bin2src.c' (a separate link unit) - keep them in sync.
+*/
 
-int is_alphabet(char ch)
+/* Attention: You must free allocated memory manually! */
+static char* str_concat(const char* str1, const char* str2)
 {
-    return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'));
+    /* via: https://stackoverflow.com/a/5901241/ */
+
+    const size_t str1_len = strlen(str1);
+    const size_t str2_len = strlen(str2);
+
+    char* new_str = malloc(str1_len + str2_len + 1);
+    if(new_str != NULL)
+    {
+        new_str[0] = '\0'; /* Ensures the memory is an empty string */
+        strcat(new_str, str1);
+        strcat(new_str, str2);
+
+        return new_str;
+    }
+    else
+    {
+        fprintf(stderr, "Error: cannot allocate memory for strings concatenation: %s and %s\n", str1, str2);
+        return NULL;
+    }
 }
 
 /*
-    Returns 0 on success, 1 on failure.
-
-    The rules for naming variables:
-    - Variable names in C++ can range from 1 to 255 characters.
-    - All variable names must begin with a letter of the alphabet or an underscore(_).
-    - After the first initial letter, variable names can also contain letters and numbers.
-    - Variable names are case sensitive.
-    - No spaces or special characters are allowed.
-    - You cannot use a C++ keyword (a reserved word) as a variable name.
-
-    Notice 1) for simplicity, this function NOT ALLOW non-ascii characters.
-    Notice 2) for simplicity, this function DONT CHECK C++ keywords.
+    Parses a non-negative decimal number, which must fit 'size_t'.
+    Returns 0 on success, non-0 on malformed, negative or too large number.
 */
-int is_valid_c_variable_name(const char* str, size_t str_len)
+static int parse_size(const char* text, size_t* out_value)
 {
-    size_t i = 0;
+    char* end = NULL;
+    unsigned long value = 0;
 
-    /* Empty name - not allowed */
-    if(str_len == 0)  return 1;
+    if(!(text[0] >= '0' && text[0] <= '9')) return 1; /* strtoul() accepts spaces and '-' */
 
-    /* Too long name - not allowed */
-    if(str_len > 255) return 1;
+    value = strtoul(text, &end, 10);
+    if(*end != '\0' || value == ULONG_MAX || (unsigned long)(size_t)value != value) return 1;
 
-    /* First character is digit - not allowed */
-    if(is_digit(str[0])) return 1;
+    *out_value = (size_t)value;
+    return 0;
+}
 
-    /* Allow only digits, alphabet characters, underscore */
-    for(; i < str_len; ++i)
-    {
-        const char ch = str[i];
+/* Returns the file name part of 'path' */
+static const char* path_base_name(const char* path)
+{
+    const char* base_name = path;
 
-        if (!is_digit(ch) && !is_alphabet(ch) && !(ch == '_'))
-        {
-            return 1;
-        }
+    for(; *path != '\0'; ++path)
+    {
+#if defined(_WIN32)
+        if(*path == '\\') base_name = path + 1;
+#endif
+        if(*path == '/') base_name = path + 1;
     }
 
-    /* Everything ok */
-    return 0;
+    return base_name;
+}
+
+/* Monotonic time in milliseconds, for '--watch' latency reports */
+static double now_ms(void)
+{
+#if defined(BIN2SRC_POSIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#else
+    return (double)clock() * 1000.0 / (double)CLOCKS_PER_SEC;
+#endif
 }
 
 /* -------------------------------------------------------------------------- */
 
+static const char APP_VERSION[] = BIN2SRC_VERSION;
+
+/* -------------------------------------------------------------------------- */
+
+/* Options, shared by all conversions of the run */
+typedef struct {
+    int         with_verify;    /* '--verify' */
+    const char* base_file_name; /* '--base', NULL - no delta encoding */
+    const char* base_var_name;  /* '--base-name' */
+
+    size_t      word_size;      /* '--word-size' */
+    int         big_endian;     /* '--endian' */
+
+    size_t      block_size;       /* '--compress' (and '--block-size'), 0 - no compression */
+    size_t      threads;          /* '--threads', 0 - one per CPU */
+    size_t      blocks_in_flight; /* '--in-flight', 0 - two per thread */
+
+    int         compact;          /* '--compact' */
+    size_t      max_line_length;  /* '--line-length' */
+
+    bin2src_stats* stats;       /* '--stats', NULL - don't collect */
+} ConvertOptions;
+
+/* -------------------------------------------------------------------------- */
+
 /*
-    Return: 0 on success, non-0 on error.
-    Attention: you must free the allocated buffer manually
+    Content-addressed output cache ('--cache DIR'), shared between build
+    directories (and parallel build jobs).
+
+    The key is a hash of: input content, mode, variable name, output file
+    name without directories (since '.c' includes the header by that name),
+    options and the tool version, so build trees in different directories
+    share entries. Cached outputs are stored as '<DIR>/<key>.h' and
+    '<DIR>/<key>.c'.
+
+    On a hit, outputs are reflinked (or copied) from the cached files, not
+    hard-linked: fetched outputs must be newer than objects built from
+    their previous contents, or build systems would skip the rebuild.
+    Generated sources are small, so copies are cheap.
+
+    Concurrency: entries and fetched outputs are published via 'write
+    temporary + rename()', which is atomic, so a reader sees either nothing
+    (or the previous file) or a complete file. A file evicted by a
+    concurrent job is just a miss.
+
+    Eviction: when the cache grows over its size limit, the least recently
+    used entries are removed. Recency is the modification time of the
+    '<DIR>/<key>.stamp' file, touched on every hit (or of the cached files,
+    before their first hit), so cached files stay as they were published.
 */
-int read_file(const char* filename, char** out_bytes, size_t* out_file_size)
-{
-    FILE* f_input = NULL;
-    size_t file_size = 0;
-    char* buffer = NULL;
-    size_t num_bytes_read = 0;
 
-    f_input = fopen(filename, "rb");
-    if(f_input == NULL)
+typedef struct {
+    const char*   dir_name; /* NULL - cache disabled */
+    unsigned long max_size; /* In bytes, 0 - unlimited */
+    unsigned long hits;
+    unsigned long misses;
+} OutputCache;
+
+/* 32-bit FNV-1a, the second half of the 64-bit content hash (with CRC32C) */
+unsigned long fnv1a(unsigned long hash, const char* bytes, size_t bytes_count)
+{
+    size_t i = 0;
+    for(; i < bytes_count; ++i)
     {
-        fprintf(stderr, "Error: can\'t open file %s\n", filename);
-        return 1;
+        hash ^= (unsigned long)(bytes[i] & 0xff);
+        hash  = (hash * 16777619UL) & 0xFFFFFFFFUL;
     }
+    return hash;
+}
+
+#define FNV1A_INIT 2166136261UL
 
-    /* Get the file length */
-    fseek(f_input, 0, SEEK_END);
-    file_size = ftell(f_input);
-    fseek(f_input, 0, SEEK_SET);
+#if defined(BIN2SRC_POSIX)
+
+/*
+    Hash of everything in 'options' that affects generated outputs.
+    'base_bytes' is the content of the '--base' file (if any).
+*/
+unsigned long hash_convert_options(const ConvertOptions* options,
+                                   const char* base_bytes, size_t base_bytes_count)
+{
+    unsigned long hash = FNV1A_INIT;
+
+    hash = fnv1a(hash, options->with_verify ? "v" : "-", 1);
 
-    if(file_size == 0)
     {
-        fprintf(stderr, "Error: file %s is empty\n", filename);
+        char format_desc[8];
+        sprintf(format_desc, "%lu%c", (unsigned long)options->word_size,
+                options->big_endian ? 'b' : 'l');
 
-        fclose(f_input);
-        return 1;;
+        hash = fnv1a(hash, format_desc, strlen(format_desc) + 1);
     }
 
-    buffer = (char*) malloc(file_size);
-    if(buffer == NULL)
+    if(options->compact)
     {
-        fprintf(stderr, "Error: cannot alocate memory (%lu bytes) to store file\'s %s content\n", (unsigned long)file_size, filename);
+        char format_desc[32];
+        sprintf(format_desc, "c%lu", (unsigned long)options->max_line_length);
 
-        fclose(f_input);
-        return 1;
+        hash = fnv1a(hash, format_desc, strlen(format_desc) + 1);
     }
 
-    num_bytes_read = fread(buffer, 1, file_size, f_input);
-    if(num_bytes_read != file_size)
+    if(options->block_size != 0)
     {
-        fprintf(stderr, "Error: cannot read the whole file %s. (read bytes: %lu != content bytes %lu)\n", filename, (unsigned long)num_bytes_read, (unsigned long)file_size);
+        char format_desc[32];
+        sprintf(format_desc, "z%lu", (unsigned long)options->block_size);
 
-        fclose(f_input);
-        free(buffer);
-        return 1;
+        hash = fnv1a(hash, format_desc, strlen(format_desc) + 1);
     }
 
-    /* Successful read */
-    fclose(f_input);
-    *out_bytes     = buffer;
-    *out_file_size = file_size;
-    return 0;
-}
+    if(options->base_file_name != NULL)
+    {
+        char base_hash[32];
+        sprintf(base_hash, "%.8lx-%lu", bin2src_crc32c(base_bytes, base_bytes_count), (unsigned long)base_bytes_count);
 
-/* -------------------------------------------------------------------------- */
+        hash = fnv1a(hash, base_hash, strlen(base_hash) + 1);
+        hash = fnv1a(hash, options->base_var_name, strlen(options->base_var_name) + 1);
+    }
 
-void write_bytes(FILE* file, const char* bytes, size_t bytes_count)
-{
-    int need_comma = 0;
+    return hash;
+}
 
+/* Writes the cache key (24 hex digits + size) into 'key' (at least 64 bytes) */
+void make_cache_key(char* key,
+                    const char* bytes, size_t bytes_count,
+                    const char* output_file_name, const char* var_name,
+                    const char* mode_name, unsigned long options_hash)
+{
+    unsigned long params_hash = FNV1A_INIT;
+    const char* params[4];
     size_t i = 0;
-    for(; i < bytes_count; ++i)
-    {
-        if(need_comma) {
-            fprintf(file, ", ");
-        } else {
-            need_comma = 1;
-        }
 
-        if( (i % 11) == 0 ) {
-            fprintf(file, "\n\t");
-        }
+    params[0] = APP_VERSION;
+    params[1] = mode_name;
+    params[2] = var_name;
+    params[3] = path_base_name(output_file_name); /* '.c' includes the header by it */
 
-        fprintf(file, "0x%.2x", bytes[i] & 0xff);
+    for(; i < 4; ++i)
+    {
+        /* Hash terminators too, so "ab"+"c" != "a"+"bc" */
+        params_hash = fnv1a(params_hash, params[i], strlen(params[i]) + 1);
     }
+    params_hash ^= options_hash;
+
+    sprintf(key, "%.8lx%.8lx%.8lx-%lu",
+            bin2src_crc32c(bytes, bytes_count),
+            fnv1a(FNV1A_INIT, bytes, bytes_count),
+            params_hash,
+            (unsigned long)bytes_count);
 }
 
-/* -------------------------------------------------------------------------- */
+/* Returns newly allocated '<dir>/<key><suffix>' */
+char* cache_file_name(const char* dir_name, const char* key, const char* suffix)
+{
+    const size_t len = strlen(dir_name) + 1 + strlen(key) + strlen(suffix);
+    char* file_name = (char*) malloc(len + 1);
+    if(file_name == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for cache file name\n");
+        return NULL;
+    }
 
-/* Attention: You must free allocated memory manually! */
-char* str_concat(const char* str1, const char* str2)
+    sprintf(file_name, "%s/%s%s", dir_name, key, suffix);
+    return file_name;
+}
+
+/*
+    Copies 'src' into 'dst' (which must not exist), trying a reflink first.
+    Returns 0 on success, non-0 on error.
+*/
+int copy_file(const char* src, const char* dst)
 {
-    /* via: https://stackoverflow.com/a/5901241/ */
+    char buffer[64 * 1024];
+    int src_fd = -1;
+    int dst_fd = -1;
+    int result = 0;
 
-    const size_t str1_len = strlen(str1);
-    const size_t str2_len = strlen(str2);
+    src_fd = open(src, O_RDONLY);
+    if(src_fd < 0) return 1;
 
-    char* new_str = malloc(str1_len + str2_len + 1);
-    if(new_str != NULL)
+    dst_fd = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if(dst_fd < 0)
     {
-        new_str[0] = '\0'; /* Ensures the memory is an empty string */
-        strcat(new_str, str1);
-        strcat(new_str, str2);
+        close(src_fd);
+        return 1;
+    }
 
-        return new_str;
+#if defined(__linux__) && defined(FICLONE)
+    if(ioctl(dst_fd, FICLONE, src_fd) == 0)
+    {
+        close(src_fd);
+        close(dst_fd);
+        return 0;
     }
-    else
+#endif
+
+    for(;;)
     {
-        fprintf(stderr, "Error: cannot allocate memory for strings concatenation: %s and %s\n", str1, str2);
-        return NULL;
+        const ssize_t n = read(src_fd, buffer, sizeof(buffer));
+        if(n == 0) break;
+        if(n < 0 || write(dst_fd, buffer, (size_t)n) != n)
+        {
+            result = 1;
+            break;
+        }
     }
-}
 
-/* -------------------------------------------------------------------------- */
+    close(src_fd);
+    if(close(dst_fd) != 0) result = 1;
 
-int write_C_header_single(
-        const char* file_name, const char* var_name,
-        const char* bytes, size_t bytes_count)
+    if(result != 0) unlink(dst);
+    return result;
+}
+
+/*
+    Atomically replaces 'dst' with a copy (or reflink) of 'src', which gets
+    a fresh modification time. Returns 0 on success.
+*/
+int publish_copy(const char* src, const char* dst)
 {
-    char* header_file_name = NULL;
-    FILE* header_file = NULL;
+    char* tmp_name = NULL;
+    char pid_suffix[32];
+    int result = 0;
+
+    sprintf(pid_suffix, ".tmp.%lu", (unsigned long)getpid());
+    tmp_name = str_concat(dst, pid_suffix);
+    if(tmp_name == NULL) return 1;
+
+    unlink(tmp_name); /* Leftover of a crashed run with the same pid */
 
-    header_file_name = str_concat(file_name, ".h");
-    if(header_file_name == NULL)
+    result = copy_file(src, tmp_name);
+    if(result == 0 && rename(tmp_name, dst) != 0)
     {
-        return 1;
+        unlink(tmp_name);
+        result = 1;
     }
 
-    header_file = fopen(header_file_name, "w");
-    if(header_file == NULL)
+    free(tmp_name);
+    return result;
+}
+
+#define CACHE_STAMP_SUFFIX ".stamp"
+
+/*
+    Returns newly allocated name of the stamp of the cache file
+    '<dir>/<key><suffix>': '<dir>/<key>.stamp' (keys don't contain dots).
+*/
+char* cache_stamp_name(const char* file_name)
+{
+    const char* dot = strrchr(file_name, '.');
+    const size_t key_len = (dot != NULL) ? (size_t)(dot - file_name) : strlen(file_name);
+    char* stamp_name = (char*) malloc(key_len + sizeof(CACHE_STAMP_SUFFIX));
+
+    if(stamp_name == NULL)
     {
-        fprintf(stderr, "Error: can\'t open the file %s", header_file_name);
+        fprintf(stderr, "Error: cannot allocate memory for cache file name\n");
+        return NULL;
+    }
 
-        free(header_file_name);
-        return 1;
+    memcpy(stamp_name, file_name, key_len);
+    strcpy(stamp_name + key_len, CACHE_STAMP_SUFFIX);
+    return stamp_name;
+}
+
+/* Marks the entry 'key' as recently used, by touching its stamp */
+void cache_touch_entry(const OutputCache* cache, const char* key)
+{
+    char* stamp_name = cache_file_name(cache->dir_name, key, CACHE_STAMP_SUFFIX);
+    int fd = -1;
+
+    if(stamp_name == NULL) return;
+
+    fd = open(stamp_name, O_WRONLY | O_CREAT, 0644);
+    if(fd >= 0)
+    {
+        close(fd);
+        utime(stamp_name, NULL); /* If it already existed */
     }
 
-    fprintf(header_file,
-            "#pragma once\n"
-            "\n"
-            "#include <stddef.h> /* for size_t */\n"
-            "\n"
-            "static const unsigned char %s_bytes[%lu] = {",
-            var_name, (unsigned long)bytes_count);
+    free(stamp_name);
+}
 
-    write_bytes(header_file, bytes, bytes_count);
+typedef struct {
+    char*         file_name;
+    char*         stamp_name;
+    time_t        mtime; /* Of the entry: latest of its files and stamp */
+    unsigned long size;
+} CacheFile;
 
-    fprintf(header_file,
-            "\n"
-            "};\n"
-            "\n"
-            "static const size_t %s_size = %lu;\n",
-            var_name, (unsigned long)bytes_count
-    );
+int compare_cache_files_by_entry(const void* a, const void* b)
+{
+    const CacheFile* fa = (const CacheFile*) a;
+    const CacheFile* fb = (const CacheFile*) b;
 
-    fclose(header_file);
-    free(header_file_name);
+    return strcmp(fa->stamp_name, fb->stamp_name);
+}
 
-    return 0;
+/* Least recently used entries first, files of an entry next to each other */
+int compare_cache_files_by_mtime(const void* a, const void* b)
+{
+    const CacheFile* fa = (const CacheFile*) a;
+    const CacheFile* fb = (const CacheFile*) b;
+
+    if(fa->mtime < fb->mtime) return -1;
+    if(fa->mtime > fb->mtime) return  1;
+    return compare_cache_files_by_entry(a, b);
 }
 
-int write_C_header_source_extern(
-        const char* file_name, const char* var_name,
-        const char* bytes, size_t bytes_count)
+/* Removes least recently used cache entries, until the cache fits 'max_size' */
+void cache_evict(const OutputCache* cache)
 {
-    char* header_file_name = NULL;
-    char* source_file_name = NULL;
+    DIR* dir = NULL;
+    struct dirent* dir_entry = NULL;
 
-    FILE* header_file = NULL;
-    FILE* source_file = NULL;
+    CacheFile* files          = NULL;
+    size_t     files_count    = 0;
+    size_t     files_capacity = 0;
+    unsigned long total_size  = 0;
+    size_t i = 0;
 
-    /* ---------------------------------------------------------------------- */
+    if(cache->max_size == 0) return;
+
+    dir = opendir(cache->dir_name);
+    if(dir == NULL) return;
 
-    header_file_name = str_concat(file_name, ".h");
-    if(header_file_name == NULL)
+    while((dir_entry = readdir(dir)) != NULL)
     {
-        return 1;
+        struct stat st;
+        struct stat stamp_st;
+        char* file_name  = NULL;
+        char* stamp_name = NULL;
+
+        if(dir_entry->d_name[0] == '.') continue;
+        if(strstr(dir_entry->d_name, ".tmp.") != NULL) continue; /* Being published */
+
+        file_name = cache_file_name(cache->dir_name, dir_entry->d_name, "");
+        if(file_name == NULL) break;
+
+        if(stat(file_name, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            free(file_name);
+            continue;
+        }
+
+        /* Stamps are accounted with their entries */
+        if(strstr(dir_entry->d_name, CACHE_STAMP_SUFFIX) != NULL)
+        {
+            free(file_name);
+            continue;
+        }
+
+        stamp_name = cache_stamp_name(file_name);
+        if(stamp_name == NULL)
+        {
+            free(file_name);
+            break;
+        }
+
+        if(stat(stamp_name, &stamp_st) == 0 && stamp_st.st_mtime > st.st_mtime)
+        {
+            st.st_mtime = stamp_st.st_mtime;
+        }
+
+        if(files_count == files_capacity)
+        {
+            const size_t new_capacity = (files_capacity == 0) ? 64 : files_capacity * 2;
+            CacheFile* new_files = (CacheFile*) realloc(files, new_capacity * sizeof(CacheFile));
+            if(new_files == NULL)
+            {
+                free(file_name);
+                free(stamp_name);
+                break;
+            }
+            files          = new_files;
+            files_capacity = new_capacity;
+        }
+
+        files[files_count].file_name  = file_name;
+        files[files_count].stamp_name = stamp_name;
+        files[files_count].mtime      = st.st_mtime;
+        files[files_count].size       = (unsigned long)st.st_size;
+        total_size += files[files_count].size;
+        ++files_count;
     }
+    closedir(dir);
 
-    source_file_name = str_concat(file_name, ".c");
-    if(source_file_name == NULL)
+    if(total_size > cache->max_size)
     {
-        free(header_file_name);
-        return 1;
+        size_t first = 0;
+
+        /* Files of an entry share its recency, so whole entries are evicted */
+        qsort(files, files_count, sizeof(CacheFile), compare_cache_files_by_entry);
+        for(i = 1; i <= files_count; ++i)
+        {
+            if(i == files_count || strcmp(files[i].stamp_name, files[first].stamp_name) != 0)
+            {
+                time_t mtime = files[first].mtime;
+                size_t k = first;
+
+                for(; k < i; ++k) if(files[k].mtime > mtime) mtime = files[k].mtime;
+                for(k = first; k < i; ++k) files[k].mtime = mtime;
+                first = i;
+            }
+        }
+
+        qsort(files, files_count, sizeof(CacheFile), compare_cache_files_by_mtime);
+
+        for(i = 0; i < files_count && total_size > cache->max_size; )
+        {
+            const char* stamp_name = files[i].stamp_name;
+
+            /* Concurrent job may have evicted them already - that's fine */
+            for(; i < files_count && strcmp(files[i].stamp_name, stamp_name) == 0; ++i)
+            {
+                unlink(files[i].file_name);
+                total_size -= files[i].size;
+            }
+            unlink(stamp_name);
+        }
     }
 
-    /* ---------------------------------------------------------------------- */
+    for(i = 0; i < files_count; ++i)
+    {
+        free(files[i].file_name);
+        free(files[i].stamp_name);
+    }
+    free(files);
+}
 
+/*
+    Links cached outputs ('<key><suffix>') to '<output_file_name><suffix>'.
+    Returns 0 on hit, non-0 on miss (including a partial hit).
+*/
+int cache_fetch_outputs(const OutputCache* cache, const char* key,
+                        const char* output_file_name,
+                        const char* const* suffixes, size_t suffixes_count)
+{
+    size_t i = 0;
+    int result = 0;
+
+    for(; i < suffixes_count && result == 0; ++i)
     {
-        header_file = fopen(header_file_name, "w");
-        if(header_file == NULL)
-        {
-            fprintf(stderr, "Error: can\'t open the file %s", header_file_name);
+        char* cached_name = cache_file_name(cache->dir_name, key, suffixes[i]);
+        char* output_name = str_concat(output_file_name, suffixes[i]);
 
-            free(header_file_name);
-            free(source_file_name);
-            return 1;
+        if(cached_name == NULL || output_name == NULL)
+        {
+            result = 1;
         }
+        else if(publish_copy(cached_name, output_name) != 0)
+        {
+            result = 1;
+        }
+
+        free(cached_name);
+        free(output_name);
+    }
 
-        fprintf(header_file,
-                "#pragma once\n"
-                "\n"
-                "#include <stddef.h> /* for size_t */\n"
-                "\n"
-                "#ifdef __cplusplus\n"
-                "extern \"C\" {\n"
-                "#endif\n"
-                "\n");
+    if(result == 0)
+    {
+        cache_touch_entry(cache, key); /* Not the linked files: see OutputCache */
+    }
+
+    return result;
+}
+
+/* Publishes '<output_file_name><suffix>' into the cache. Returns 0 on success */
+int cache_store_outputs(const OutputCache* cache, const char* key,
+                        const char* output_file_name,
+                        const char* const* suffixes, size_t suffixes_count)
+{
+    size_t i = 0;
+    int result = 0;
 
-        fprintf(header_file,
-                "extern const unsigned char* %s_bytes;\n"
-                "extern size_t               %s_size;\n",
-                var_name, var_name);
+    for(; i < suffixes_count && result == 0; ++i)
+    {
+        char* cached_name = cache_file_name(cache->dir_name, key, suffixes[i]);
+        char* output_name = str_concat(output_file_name, suffixes[i]);
 
-        fprintf(header_file,
-                "\n"
-                "#ifdef __cplusplus\n"
-                "} /* extern \"C\" */\n"
-                "#endif\n");
+        if(cached_name == NULL || output_name == NULL || publish_copy(output_name, cached_name) != 0)
+        {
+            result = 1;
+        }
 
-        fclose(header_file);
+        free(cached_name);
+        free(output_name);
     }
 
-    /* ---------------------------------------------------------------------- */
+    return result;
+}
+
+#endif /* BIN2SRC_POSIX */
+
+/* -------------------------------------------------------------------------- */
+
+/*
+    Converts a single input file into output file(s) in the given mode.
+
+    'buffer' and 'buffer_capacity' hold the input bytes and are reused
+    between calls (see bin2src_read_file()), the caller must free '*buffer'.
 
+    'cache' may be NULL (or have NULL 'dir_name') to disable caching.
+
+    Returns 0 on success, non-0 on error.
+*/
+int convert_file(
+        const char* input_file_name, const char* output_file_name,
+        const char* var_name, bin2src_mode mode,
+        const ConvertOptions* options,
+        OutputCache* cache,
+        char** buffer, size_t* buffer_capacity)
+{
+    static const char* const OUTPUT_SUFFIXES[2] = { ".h", ".c" };
+    const size_t outputs_count = (mode == BIN2SRC_MODE_C_HEADER_SINGLE) ? 1 : 2;
+
+    bin2src_options convert_options;
+    bin2src_input   input;
+    bin2src_input   base;
+    size_t input_file_size = 0;
+    int result = -1;
+
+    char*  base_file_buffer   = NULL;
+    size_t base_file_capacity = 0;
+    size_t base_file_size     = 0;
+
+    const int use_cache = (cache != NULL) && (cache->dir_name != NULL);
+    char cache_key[64];
+
+    bin2src_options_init(&convert_options);
+    convert_options.mode             = mode;
+    convert_options.var_name         = var_name;
+    convert_options.with_verify      = options->with_verify;
+    convert_options.word_size        = options->word_size;
+    convert_options.big_endian       = options->big_endian;
+    convert_options.block_size       = options->block_size;
+    convert_options.threads          = options->threads;
+    convert_options.blocks_in_flight = options->blocks_in_flight;
+    convert_options.compact          = options->compact;
+    convert_options.max_line_length  = options->max_line_length;
+    convert_options.base_var_name    = options->base_var_name;
+    convert_options.stats            = options->stats;
+    convert_options.log              = stdout;
+
+    if(options->base_file_name != NULL)
     {
-        source_file = fopen(source_file_name, "w");
-        if(source_file == NULL)
+        if(bin2src_read_file(options->base_file_name, &base_file_buffer, &base_file_capacity, &base_file_size) != 0)
         {
-            fprintf(stderr, "Error: can\'t open the file %s", source_file_name);
+            free(base_file_buffer);
+            return 1;
+        }
+
+        bin2src_input_memory(&base, base_file_buffer, base_file_size);
+        base.name = options->base_file_name;
 
-            free(header_file_name);
-            free(source_file_name);
+        convert_options.base = &base;
+    }
+
+    if(use_cache || base_file_buffer != NULL)
+    {
+        /* Whole input is needed: to compute the cache key or the delta */
+        if(bin2src_read_file(input_file_name, buffer, buffer_capacity, &input_file_size) != 0)
+        {
+            free(base_file_buffer);
             return 1;
         }
 
-        fprintf(source_file, "#include \"%s\"\n", header_file_name);
-        fprintf(source_file, "\n");
+        bin2src_input_memory(&input, *buffer, input_file_size);
+        input.name = input_file_name;
+    }
+    else
+    {
+        /* Streamed through the read/format/write pipeline */
+        bin2src_input_file(&input, input_file_name);
+    }
 
-        fprintf(source_file, "static const unsigned char %s_bytes[%lu] = {", var_name, (unsigned long)bytes_count);
-        write_bytes(source_file, bytes, bytes_count);
-        fprintf(source_file,
-                "\n"
-                "};\n"
-                "\n");
+#if defined(BIN2SRC_POSIX)
+    if(use_cache)
+    {
+        make_cache_key(cache_key, *buffer, input_file_size,
+                       output_file_name, var_name, bin2src_mode_name(mode),
+                       hash_convert_options(options, base_file_buffer, base_file_size));
 
-        fprintf(source_file,
-                "static const size_t %s_size = %lu;\n",
-                var_name, (unsigned long)bytes_count);
+        if(cache_fetch_outputs(cache, cache_key, output_file_name, OUTPUT_SUFFIXES, outputs_count) == 0)
+        {
+            free(base_file_buffer);
 
-        fclose(source_file);
+            ++cache->hits;
+            return 0;
+        }
+
+        ++cache->misses;
     }
+#else
+    (void)use_cache;
+    (void)cache_key;
+    (void)OUTPUT_SUFFIXES;
+    (void)outputs_count;
+    (void)input_file_size;
+#endif
 
-    /* ---------------------------------------------------------------------- */
+    result = bin2src_convert_to_files(&input, &convert_options, output_file_name);
+
+    free(base_file_buffer);
+
+    if(result != 0)
+    {
+        fprintf(stderr, "Error during writing output into file\n");
+        return 1;
+    }
 
-    free(header_file_name);
-    free(source_file_name);
+#if defined(BIN2SRC_POSIX)
+    if(use_cache)
+    {
+        /* Not fatal: outputs are already written */
+        if(cache_store_outputs(cache, cache_key, output_file_name, OUTPUT_SUFFIXES, outputs_count) != 0)
+        {
+            fprintf(stderr, "Warning: cannot store %s into cache %s\n", output_file_name, cache->dir_name);
+        }
+
+        cache_evict(cache);
+    }
+#endif
 
     return 0;
 }
 
-int write_C_header_source_funcs(
-        const char* file_name, const char* var_name,
-        const char* bytes, size_t bytes_count)
+/* -------------------------------------------------------------------------- */
+
+/*
+    Manifest - a text file with one conversion per line:
+
+        INPUT_FILE_NAME OUTPUT_FILE_NAME VARIABLE_NAME [MODE]
+
+    Fields are separated by spaces or tabs (so names with spaces are not
+    supported). Empty lines and lines started with '#' are skipped.
+    Missing MODE means 'c_header'.
+*/
+
+typedef struct {
+    const char* input_file_name;
+    const char* output_file_name;
+    const char* var_name;
+    bin2src_mode        mode;
+} ManifestEntry;
+
+typedef struct {
+    char*          text;          /* Manifest content, entries points into it */
+    ManifestEntry* entries;
+    size_t         entries_count;
+} Manifest;
+
+int is_blank(char ch)
 {
-    char* header_file_name = NULL;
-    char* source_file_name = NULL;
+    return (ch == ' ' || ch == '\t' || ch == '\r');
+}
 
-    FILE* header_file = NULL;
-    FILE* source_file = NULL;
+/*
+    Splits the line into (null-terminated in-place) fields, separated by
+    spaces or tabs, up to the end or a '#' comment. Returns the number of
+    fields, or 'max_fields' + 1 if there are more.
+*/
+size_t split_fields(char* line, char** fields, size_t max_fields)
+{
+    size_t fields_count = 0;
+    char* p = line;
 
-    /* ---------------------------------------------------------------------- */
+    for(;;)
+    {
+        while(is_blank(*p)) ++p;
+        if(*p == '\0' || *p == '#') break;
+
+        if(fields_count == max_fields) return max_fields + 1;
+
+        fields[fields_count++] = p;
+        while(*p != '\0' && !is_blank(*p)) ++p;
+        if(*p != '\0')
+        {
+            *p = '\0';
+            ++p;
+        }
+    }
 
-    header_file_name = str_concat(file_name, ".h");
-    if(header_file_name == NULL)
+    return fields_count;
+}
+
+/*
+    Reads the whole text file as a null-terminated string, and counts its
+    lines. Returns 0 on success, non-0 on error (already reported)
+*/
+int read_text_file(const char* filename, char** out_text, size_t* out_lines_count)
+{
+    char*  bytes          = NULL;
+    size_t bytes_capacity = 0;
+    size_t bytes_size     = 0;
+    size_t lines_count = 1;
+    size_t i = 0;
+    char*  text = NULL;
+
+    if(bin2src_read_file(filename, &bytes, &bytes_capacity, &bytes_size) != 0)
     {
+        free(bytes);
         return 1;
     }
 
-    source_file_name = str_concat(file_name, ".c");
-    if(source_file_name == NULL)
+    /* Null-terminated copy: tokens are cut in-place */
+    text = (char*) malloc(bytes_size + 1);
+    if(text == NULL)
     {
-        free(header_file_name);
+        fprintf(stderr, "Error: cannot allocate memory for %s\n", filename);
+
+        free(bytes);
         return 1;
     }
+    memcpy(text, bytes, bytes_size);
+    text[bytes_size] = '\0';
+    free(bytes);
 
-    /* ---------------------------------------------------------------------- */
+    for(i = 0; i < bytes_size; ++i)
+    {
+        if(text[i] == '\n') ++lines_count;
+    }
+
+    *out_text        = text;
+    *out_lines_count = lines_count;
+    return 0;
+}
 
+/* Cuts the next line of the text in-place. Returns the line after it, or NULL */
+char* next_text_line(char* line)
+{
+    char* next_line = strchr(line, '\n');
+
+    if(next_line != NULL)
     {
-        header_file = fopen(header_file_name, "w");
-        if(header_file == NULL)
-        {
-            fprintf(stderr, "Error: can\'t open the file %s", header_file_name);
+        *next_line = '\0';
+        ++next_line;
+    }
+    return next_line;
+}
 
-            free(header_file_name);
-            free(source_file_name);
-            return 1;
-        }
+void free_manifest(Manifest* manifest)
+{
+    free(manifest->text);
+    free(manifest->entries);
 
-        fprintf(header_file,
-                "#pragma once\n"
-                "\n"
-                "#include <stddef.h> /* for size_t */\n"
-                "\n"
-                "#ifdef __cplusplus\n"
-                "extern \"C\" {\n"
-                "#endif\n"
-                "\n");
+    manifest->text          = NULL;
+    manifest->entries       = NULL;
+    manifest->entries_count = 0;
+}
 
-        fprintf(header_file,
-                "const unsigned char* get_%s_bytes();\n"
-                "size_t               get_%s_size();\n",
-                var_name, var_name);
+/* Returns 0 on success, non-0 on error (already reported) */
+int read_manifest(const char* filename, Manifest* out_manifest)
+{
+    size_t lines_count = 0;
+    size_t line_number = 0;
+    char*  line = NULL;
 
-        fprintf(header_file,
-                "\n"
-                "#ifdef __cplusplus\n"
-                "} /* extern \"C\" */\n"
-                "#endif\n");
+    Manifest manifest;
+    manifest.text          = NULL;
+    manifest.entries       = NULL;
+    manifest.entries_count = 0;
 
-        fclose(header_file);
+    if(read_text_file(filename, &manifest.text, &lines_count) != 0)
+    {
+        return 1;
     }
 
-    /* ---------------------------------------------------------------------- */
+    manifest.entries = (ManifestEntry*) malloc(lines_count * sizeof(ManifestEntry));
+    if(manifest.entries == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for manifest %s\n", filename);
+
+        free_manifest(&manifest);
+        return 1;
+    }
 
+    line = manifest.text;
+    while(line != NULL)
     {
-        source_file = fopen(source_file_name, "w");
-        if(source_file == NULL)
+        char* fields[4] = { NULL, NULL, NULL, NULL };
+        char* next_line = next_text_line(line);
+        const size_t fields_count = split_fields(line, fields, 4);
+
+        ++line_number;
+
+        if(fields_count > 4)
         {
-            fprintf(stderr, "Error: can\'t open the file %s", source_file_name);
+            fprintf(stderr, "Error: %s:%lu: too many fields\n", filename, (unsigned long)line_number);
 
-            free(header_file_name);
-            free(source_file_name);
+            free_manifest(&manifest);
             return 1;
         }
 
-        fprintf(source_file,
-                "#include \"%s\"\n"
-                "\n", header_file_name);
+        if(fields_count > 0)
+        {
+            ManifestEntry* entry = &manifest.entries[manifest.entries_count];
 
-        fprintf(source_file, "static const unsigned char %s_bytes[%lu] = {", var_name, (unsigned long)bytes_count);
-        write_bytes(source_file, bytes, bytes_count);
-        fprintf(source_file,
-                "\n"
-                "};\n"
-                "\n");
+            if(fields_count < 3)
+            {
+                fprintf(stderr, "Error: %s:%lu: expected INPUT_FILE_NAME OUTPUT_FILE_NAME VARIABLE_NAME [MODE]\n", filename, (unsigned long)line_number);
+
+                free_manifest(&manifest);
+                return 1;
+            }
 
-        fprintf(source_file,
-                "static const size_t %s_size = %lu;\n",
-                var_name, (unsigned long)bytes_count);
+            entry->input_file_name  = fields[0];
+            entry->output_file_name = fields[1];
+            entry->var_name         = fields[2];
+            entry->mode             = BIN2SRC_MODE_C_HEADER_SINGLE;
 
-        fprintf(source_file,
-                "\n"
-                "/* ------------------------------------------------------ */\n"
-                "\n"
-                "const unsigned char* get_%s_bytes() { return %s_bytes; }\n",
-                var_name, var_name);
-        fprintf(source_file,
-                "size_t               get_%s_size()  { return %s_size; }\n",
-                var_name, var_name);
+            if(bin2src_check_var_name(entry->var_name, strlen(entry->var_name)) != 0)
+            {
+                fprintf(stderr, "Error: %s:%lu: invalid var name %s\n", filename, (unsigned long)line_number, entry->var_name);
 
-        fclose(source_file);
+                free_manifest(&manifest);
+                return 1;
+            }
+
+            if(fields[3] != NULL)
+            {
+                entry->mode = bin2src_mode_from_name(fields[3]);
+                if(entry->mode == (bin2src_mode)-1)
+                {
+                    fprintf(stderr, "Error: %s:%lu: undefined mode: %s\n", filename, (unsigned long)line_number, fields[3]);
+
+                    free_manifest(&manifest);
+                    return 1;
+                }
+            }
+
+            ++manifest.entries_count;
+        }
+
+        line = next_line;
     }
 
-    /* ---------------------------------------------------------------------- */
+    if(manifest.entries_count == 0)
+    {
+        fprintf(stderr, "Error: manifest %s has no entries\n", filename);
 
-    free(header_file_name);
-    free(source_file_name);
+        free_manifest(&manifest);
+        return 1;
+    }
 
+    *out_manifest = manifest;
     return 0;
 }
 
-int write_C_header_source_struct_extern(
-        const char* file_name, const char* var_name,
-        const char* bytes, size_t bytes_count)
+/* -------------------------------------------------------------------------- */
+
+/*
+    Trace - a text file with assets (or their byte ranges) touched at
+    startup, in the order of access, one per line:
+
+        ASSET_NAME [OFFSET LENGTH]
+
+    Asset names are variable names of the manifest. Missing range means the
+    whole asset. Empty lines and lines started with '#' are skipped.
+*/
+
+typedef struct {
+    char*                text;         /* Trace content, ranges points into it */
+    bin2src_trace_range* ranges;
+    size_t               ranges_count;
+} Trace;
+
+void free_trace(Trace* trace)
 {
-    char* header_file_name = NULL;
-    char* source_file_name = NULL;
+    free(trace->text);
+    free(trace->ranges);
 
-    FILE* header_file = NULL;
-    FILE* source_file = NULL;
+    trace->text         = NULL;
+    trace->ranges       = NULL;
+    trace->ranges_count = 0;
+}
 
-    /* ---------------------------------------------------------------------- */
+/* Returns 0 on success, non-0 on error (already reported) */
+int read_trace(const char* filename, Trace* out_trace)
+{
+    size_t lines_count = 0;
+    size_t line_number = 0;
+    char*  line = NULL;
+
+    Trace trace;
+    trace.text         = NULL;
+    trace.ranges       = NULL;
+    trace.ranges_count = 0;
 
-    header_file_name = str_concat(file_name, ".h");
-    if(header_file_name == NULL)
+    if(read_text_file(filename, &trace.text, &lines_count) != 0)
     {
         return 1;
     }
 
-    source_file_name = str_concat(file_name, ".c");
-    if(source_file_name == NULL)
+    trace.ranges = (bin2src_trace_range*) malloc(lines_count * sizeof(bin2src_trace_range));
+    if(trace.ranges == NULL)
     {
-        free(header_file_name);
+        fprintf(stderr, "Error: cannot allocate memory for trace %s\n", filename);
+
+        free_trace(&trace);
         return 1;
     }
 
-    /* ---------------------------------------------------------------------- */
-
+    line = trace.text;
+    while(line != NULL)
     {
-        header_file = fopen(header_file_name, "w");
-        if(header_file == NULL)
+        char* fields[3] = { NULL, NULL, NULL };
+        char* next_line = next_text_line(line);
+        const size_t fields_count = split_fields(line, fields, 3);
+
+        ++line_number;
+
+        if(fields_count == 1 || fields_count == 3)
         {
-            fprintf(stderr, "Error: can\'t open the file %s", header_file_name);
+            bin2src_trace_range* range = &trace.ranges[trace.ranges_count++];
+
+            range->asset_name = fields[0];
+            range->offset     = 0;
+            range->length     = 0;
 
-            free(header_file_name);
-            free(source_file_name);
+            if( (fields_count == 3) &&
+                ( (parse_size(fields[1], &range->offset) != 0) ||
+                  (parse_size(fields[2], &range->length) != 0) || (range->length == 0) ) )
+            {
+                fprintf(stderr, "Error: %s:%lu: invalid range %s %s\n", filename, (unsigned long)line_number, fields[1], fields[2]);
+
+                free_trace(&trace);
+                return 1;
+            }
+        }
+        else if(fields_count != 0)
+        {
+            fprintf(stderr, "Error: %s:%lu: expected ASSET_NAME [OFFSET LENGTH]\n", filename, (unsigned long)line_number);
+
+            free_trace(&trace);
             return 1;
         }
 
-        fprintf(header_file,
-                "#pragma once\n"
-                "\n"
-                "#include <stddef.h> /* for size_t */\n"
-                "\n"
-                "#ifdef __cplusplus\n"
-                "extern \"C\" {\n"
-                "#endif\n"
-                "\n");
+        line = next_line;
+    }
+
+    *out_trace = trace;
+    return 0;
+}
+
+/*
+    Packs inputs of all manifest entries into one output, named by their
+    variable names (output file names and modes of entries are ignored),
+    laid out by the trace (may be NULL).
 
-        fprintf(header_file,
-                "typedef struct %s_data\n"
-                "{\n"
-                "    const unsigned char* bytes;\n"
-                "    size_t               size;\n"
-                "} %s_data;\n"
-                "\n"
-                "extern const %s_data %s;\n",
-                var_name, var_name, var_name, var_name);
+    Returns 0 on success, non-0 on error.
+*/
+int pack_files(const Manifest* manifest, const Trace* trace,
+               const char* output_file_name, const char* var_name, size_t page_size,
+               const ConvertOptions* options)
+{
+    bin2src_pack_options pack_options;
+    bin2src_pack_asset*  assets = NULL;
+    size_t i = 0;
+    int result = 0;
+
+    assets = (bin2src_pack_asset*) malloc(manifest->entries_count * sizeof(bin2src_pack_asset));
+    if(assets == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for the pack %s\n", var_name);
+        return 1;
+    }
+
+    for(i = 0; i < manifest->entries_count; ++i)
+    {
+        assets[i].name = manifest->entries[i].var_name;
+        bin2src_input_file(&assets[i].input, manifest->entries[i].input_file_name);
+    }
 
-        fprintf(header_file,
-                "\n"
-                "#ifdef __cplusplus\n"
-                "} /* extern \"C\" */\n"
-                "#endif\n");
+    bin2src_pack_options_init(&pack_options);
+    pack_options.var_name        = var_name;
+    pack_options.page_size       = page_size;
+    pack_options.compact         = options->compact;
+    pack_options.max_line_length = options->max_line_length;
+    pack_options.stats           = options->stats;
+    pack_options.log             = stdout;
 
-        fclose(header_file);
+    if(trace != NULL)
+    {
+        pack_options.trace       = trace->ranges;
+        pack_options.trace_count = trace->ranges_count;
     }
 
-    /* ---------------------------------------------------------------------- */
+    result = bin2src_pack_to_files(assets, manifest->entries_count, &pack_options, output_file_name);
 
+    free(assets);
+
+    if(result != 0)
     {
-        source_file = fopen(source_file_name, "w");
-        if(source_file == NULL)
-        {
-            fprintf(stderr, "Error: can\'t open the file %s", source_file_name);
+        fprintf(stderr, "Error during writing output into file\n");
+        return 1;
+    }
 
-            free(header_file_name);
-            free(source_file_name);
-            return 1;
-        }
+    return 0;
+}
 
-        fprintf(source_file,
-                "#include \"%s\"\n"
-                "\n", header_file_name);
+/* -------------------------------------------------------------------------- */
 
-        fprintf(source_file, "static const unsigned char %s_bytes[%lu] = {", var_name, (unsigned long)bytes_count);
-        write_bytes(source_file, bytes, bytes_count);
-        fprintf(source_file,
-                "\n"
-                "};\n");
+#if defined(__linux__)
 
-        fprintf(source_file,
-                "\n"
-                "/* ------------------------------------------------------ */\n"
-                "\n"
-                "static const %s_data %s = {%s_bytes, %lu};\n",
-                var_name, var_name, var_name, (unsigned long)bytes_count);
+/*
+    Watch mode: generates every manifest entry once, then watches the
+    directories of the inputs via inotify and regenerates only the entries
+    whose input changed. A change of the '--base' file regenerates all of
+    them, since deltas are encoded against it.
 
-        fclose(source_file);
-    }
+    We watch directories, not files: editors usually save via
+    'write temporary + rename', which would silently drop a per-file watch.
 
-    /* ---------------------------------------------------------------------- */
+    Events are debounced: after the first event we keep collecting events
+    until nothing arrives for 'debounce_ms', so a burst of saves causes a
+    single regeneration. The parsed manifest and the input buffer stay
+    alive between regenerations.
 
-    free(header_file_name);
-    free(source_file_name);
+    Returns non-0 on error, otherwise never returns.
+*/
 
-    return 0;
-}
+typedef struct {
+    char* dir_name;
+    int   wd; /* inotify watch descriptor */
+} WatchedDir;
+
+typedef struct {
+    size_t      dir_index;  /* Index in watched directories */
+    const char* base_name;  /* Input file name without directory */
+    int         dirty;
+} WatchedEntry;
 
-int write_C_header_source_struct_func(
-        const char* file_name, const char* var_name,
-        const char* bytes, size_t bytes_count)
+/* Returns newly allocated directory part of 'path' ("." if there is none) */
+char* path_dir_name(const char* path)
 {
-    char* header_file_name = NULL;
-    char* source_file_name = NULL;
+    const char* slash = strrchr(path, '/');
+    size_t dir_len = 0;
+    char* dir_name = NULL;
 
-    FILE* header_file = NULL;
-    FILE* source_file = NULL;
+    if(slash == NULL) return str_concat(".", "");
 
-    /* ---------------------------------------------------------------------- */
+    dir_len = (slash == path) ? 1 : (size_t)(slash - path); /* Keep root '/' */
 
-    header_file_name = str_concat(file_name, ".h");
-    if(header_file_name == NULL)
+    dir_name = (char*) malloc(dir_len + 1);
+    if(dir_name == NULL)
     {
-        return 1;
+        fprintf(stderr, "Error: cannot allocate memory for directory name of %s\n", path);
+        return NULL;
     }
+    memcpy(dir_name, path, dir_len);
+    dir_name[dir_len] = '\0';
+
+    return dir_name;
+}
+
+/*
+    Watches the directory of 'file_name' (unless it's already in 'dirs') and
+    fills 'out_watched' for the file. Returns 0 on success, non-0 on error.
+*/
+int watch_file(int fd, const char* file_name,
+               WatchedDir* dirs, size_t* dirs_count, WatchedEntry* out_watched)
+{
+    char* dir_name = path_dir_name(file_name);
+    size_t d = 0;
+
+    if(dir_name == NULL) return 1;
 
-    source_file_name = str_concat(file_name, ".c");
-    if(source_file_name == NULL)
+    for(d = 0; d < *dirs_count; ++d)
     {
-        free(header_file_name);
-        return 1;
+        if(strcmp(dirs[d].dir_name, dir_name) == 0) break;
     }
 
-    /* ---------------------------------------------------------------------- */
-
+    if(d == *dirs_count)
     {
-        header_file = fopen(header_file_name, "w");
-        if(header_file == NULL)
+        dirs[d].dir_name = dir_name;
+        dirs[d].wd = inotify_add_watch(fd, dir_name, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if(dirs[d].wd < 0)
         {
-            fprintf(stderr, "Error: can\'t open the file %s", header_file_name);
-
-            free(header_file_name);
-            free(source_file_name);
+            fprintf(stderr, "Error: cannot watch directory %s\n", dir_name);
+            free(dir_name);
             return 1;
         }
+        ++(*dirs_count);
+    }
+    else
+    {
+        free(dir_name);
+    }
 
-        fprintf(header_file,
-                "#pragma once\n"
-                "\n"
-                "#include <stddef.h> /* for size_t */\n"
-                "\n"
-                "#ifdef __cplusplus\n"
-                "extern \"C\" {\n"
-                "#endif\n"
-                "\n");
+    out_watched->dir_index = d;
+    out_watched->base_name = path_base_name(file_name);
+    out_watched->dirty     = 1; /* Initial generation */
 
-        fprintf(header_file,
-                "typedef struct %s_data\n"
-                "{\n"
-                "    const unsigned char* bytes;\n"
-                "    size_t               size;\n"
-                "} %s_data;\n"
-                "\n"
-                "const %s_data* get_%s_data();\n",
-                var_name, var_name, var_name, var_name);
+    return 0;
+}
 
-        fprintf(header_file,
-                "\n"
-                "#ifdef __cplusplus\n"
-                "} /* extern \"C\" */\n"
-                "#endif\n");
+int is_watched_event(const struct inotify_event* event, const WatchedDir* dirs, const WatchedEntry* watched)
+{
+    return (dirs[watched->dir_index].wd == event->wd) && (strcmp(watched->base_name, event->name) == 0);
+}
 
-        fclose(header_file);
-    }
+/*
+    Reads all pending inotify events and marks affected entries as dirty.
+    A change of the base file ('base' may be NULL) marks all of them.
+*/
+void watch_collect_events(int fd,
+                          const WatchedDir* dirs,
+                          WatchedEntry* watched, const Manifest* manifest,
+                          const WatchedEntry* base)
+{
+    union {
+        struct inotify_event event; /* For proper alignment */
+        char bytes[4096];
+    } events;
 
-    /* ---------------------------------------------------------------------- */
+    const ssize_t len = read(fd, events.bytes, sizeof(events.bytes));
+    ssize_t offset = 0;
 
+    while(offset < len)
     {
-        source_file = fopen(source_file_name, "w");
-        if(source_file == NULL)
-        {
-            fprintf(stderr, "Error: can\'t open the file %s", source_file_name);
+        const struct inotify_event* event = (const struct inotify_event*)(events.bytes + offset);
+        size_t i = 0;
 
-            free(header_file_name);
-            free(source_file_name);
-            return 1;
+        if( (event->mask & IN_Q_OVERFLOW) || /* Events lost - regenerate everything */
+            (event->len > 0 && base != NULL && is_watched_event(event, dirs, base)) )
+        {
+            for(i = 0; i < manifest->entries_count; ++i) watched[i].dirty = 1;
+        }
+        else if(event->len > 0)
+        {
+            for(i = 0; i < manifest->entries_count; ++i)
+            {
+                if(is_watched_event(event, dirs, &watched[i]))
+                {
+                    watched[i].dirty = 1;
+                }
+            }
         }
 
-        fprintf(source_file,
-                "#include \"%s\"\n"
-                "\n", header_file_name);
-
-        fprintf(source_file, "static const unsigned char %s_bytes[%lu] = {", var_name, (unsigned long)bytes_count);
-        write_bytes(source_file, bytes, bytes_count);
-        fprintf(source_file,
-                "\n"
-                "};\n");
-
-        fprintf(source_file,
-                "\n"
-                "/* ------------------------------------------------------ */\n"
-                "\n"
-                "static const %s_data %s_data_struct = {%s_bytes, %lu};\n"
-                "\n",
-                var_name, var_name, var_name, (unsigned long) bytes_count);
-
-        fprintf(source_file,
-                "const %s_data* get_%s_data() { return &%s_data_struct; }\n",
-                var_name, var_name, var_name);
-
-        fclose(source_file);
+        offset += sizeof(struct inotify_event) + event->len;
     }
+}
 
-    /* ---------------------------------------------------------------------- */
+int run_watch(const Manifest* manifest, const ConvertOptions* options, OutputCache* cache, int debounce_ms)
+{
+    WatchedDir*   dirs       = NULL; /* Directories of inputs and the base */
+    size_t        dirs_count = 0;
+    WatchedEntry* watched    = NULL;
+    WatchedEntry  base_watched;
 
-    free(header_file_name);
-    free(source_file_name);
+    char*  buffer          = NULL;
+    size_t buffer_capacity = 0;
 
-    return 0;
-}
+    int fd = -1;
+    int result = 0;
+    size_t i = 0;
+    double changed_at = 0.0;
 
-/* -------------------------------------------------------------------------- */
+    dirs    = (WatchedDir*)   malloc((manifest->entries_count + 1) * sizeof(WatchedDir));
+    watched = (WatchedEntry*) malloc(manifest->entries_count * sizeof(WatchedEntry));
+    if(dirs == NULL || watched == NULL)
+    {
+        fprintf(stderr, "Error: cannot allocate memory for watch mode\n");
+        result = 1;
+    }
 
-typedef enum {
-      MODE_C_HEADER_SINGLE = 0
-    , MODE_C_HEADER_SOURCE_EXTERN
-    , MODE_C_HEADER_SOURCE_FUNCS
-    , MODE_C_HEADER_SOURCE_STRUCT_EXTERN
-    , MODE_C_HEADER_SOURCE_STRUCT_FUNC
-} Mode;
+    if(result == 0)
+    {
+        fd = inotify_init();
+        if(fd < 0)
+        {
+            fprintf(stderr, "Error: inotify_init() failed\n");
+            result = 1;
+        }
+    }
 
-typedef struct {
-    Mode   mode;
-    const char* mode_name;
-} ModeInfo;
+    /* Watch each (unique) input directory, and the one of the base */
+    for(i = 0; result == 0 && i < manifest->entries_count; ++i)
+    {
+        result = watch_file(fd, manifest->entries[i].input_file_name, dirs, &dirs_count, &watched[i]);
+    }
 
-#define MODES_COUNT 5
+    if(result == 0 && options->base_file_name != NULL)
+    {
+        result = watch_file(fd, options->base_file_name, dirs, &dirs_count, &base_watched);
+    }
 
-static const ModeInfo MODES[MODES_COUNT] =
-{
-      { MODE_C_HEADER_SINGLE,        "c_header" }
+    if(result == 0)
+    {
+        fprintf(stdout, "Watching %lu input(s) in %lu directory(ies), debounce %i ms\n",
+                (unsigned long)manifest->entries_count, (unsigned long)dirs_count, debounce_ms);
+        changed_at = now_ms();
+    }
 
-    , { MODE_C_HEADER_SOURCE_EXTERN, "c_extern" }
-    , { MODE_C_HEADER_SOURCE_FUNCS,  "c_funcs"  }
+    while(result == 0)
+    {
+        struct pollfd pfd;
 
-    , { MODE_C_HEADER_SOURCE_STRUCT_EXTERN, "c_struct_extern" }
-    , { MODE_C_HEADER_SOURCE_STRUCT_FUNC,   "c_struct_func"   }
-};
+        /* Regenerate dirty entries */
+        for(i = 0; i < manifest->entries_count; ++i)
+        {
+            const ManifestEntry* entry = &manifest->entries[i];
+            double started_at = 0.0;
+            int converted = 0;
+
+            if(!watched[i].dirty) continue;
+            watched[i].dirty = 0;
+
+            started_at = now_ms();
+            converted = convert_file(entry->input_file_name, entry->output_file_name,
+                                     entry->var_name, entry->mode, options, cache,
+                                     &buffer, &buffer_capacity);
+
+            fprintf(stdout, "%s %s -> %s in %.3f ms (%.3f ms since change)\n",
+                    (converted == 0) ? "Regenerated" : "FAILED",
+                    entry->input_file_name, entry->output_file_name,
+                    now_ms() - started_at, now_ms() - changed_at);
+        }
 
-/* Returns -1 in case of missmatch */
-Mode get_mode_from_str(const char* str)
-{
-    size_t i = 0;
-    for(; i < MODES_COUNT; ++i)
-    {
-        if( strcmp(str, MODES[i].mode_name) == 0 ) /* str is equal to mode[i].name */
+        if(cache->dir_name != NULL)
         {
-            return MODES[i].mode;
+            fprintf(stdout, "Cache: %lu hit(s), %lu miss(es)\n", cache->hits, cache->misses);
         }
-    }
 
-    /* Undefined mode */
-    return -1;
-}
+        if(options->stats != NULL)
+        {
+            bin2src_print_stats(stdout, options->stats);
+        }
+        fflush(stdout);
 
-/* Returns 0 on success, otherwize non-0 */
-int is_valid_mode(const Mode mode)
-{
-    size_t i = 0;
-    for(; i < MODES_COUNT; ++i)
-    {
-        if( mode == MODES[i].mode )
+        /* Wait for the first event ... */
+        pfd.fd      = fd;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, -1) < 0)
         {
-            return 0; /* Mode found */
+            if(errno == EINTR) continue;
+
+            fprintf(stderr, "Error: poll() failed\n");
+            result = 1;
+            break;
         }
+
+        /* ... and debounce the rest of the burst */
+        do {
+            watch_collect_events(fd, dirs, watched, manifest,
+                                 (options->base_file_name != NULL) ? &base_watched : NULL);
+            changed_at = now_ms();
+        } while(poll(&pfd, 1, debounce_ms) > 0);
     }
 
-    /* Mode not found */
+    if(fd >= 0) close(fd);
+    for(i = 0; i < dirs_count; ++i) free(dirs[i].dir_name);
+    free(dirs);
+    free(watched);
+    free(buffer);
+
     return 1;
 }
 
-void print_modes(FILE* output)
-{
-    size_t i = 0;
-    for(; i < MODES_COUNT; ++i)
-    {
-        fprintf(output, "\t%s\n", MODES[i].mode_name);
-    }
-}
+#endif /* __linux__ */
 
 /* -------------------------------------------------------------------------- */
 
-static const char APP_VERSION[] = "1.0.2";
-
 int main(int argc, char* argv[])
 {
     const char* app_name = (argc > 0) ? argv[0] : NULL;
@@ -735,12 +1393,50 @@ int main(int argc, char* argv[])
     char* output_file_name = NULL;
     char* var_name         = NULL;
 
-    Mode mode = MODE_C_HEADER_SINGLE;
+    bin2src_mode mode = BIN2SRC_MODE_C_HEADER_SINGLE;
+
+    ConvertOptions options;
+
+    char* manifest_file_name = NULL;
+    int   debounce_ms        = 100;
+
+    int    compress       = 0;
+    size_t block_size_kib = 64;
+
+    const char* pack_manifest_file_name = NULL;
+    const char* trace_file_name         = NULL;
+    size_t      page_size               = 4096;
+
+    OutputCache cache;
+
+    bin2src_stats stats;
 
     /* --------------------------- */
 
-    char*  input_file_buffer = NULL;
-    size_t input_file_size   = 0;
+    char*  input_file_buffer          = NULL;
+    size_t input_file_buffer_capacity = 0;
+
+    options.with_verify      = 0;
+    options.base_file_name   = NULL;
+    options.base_var_name    = NULL;
+    options.stats            = NULL;
+
+    options.word_size        = 1;
+    options.big_endian       = 0;
+
+    options.block_size       = 0;
+    options.threads          = 0;
+    options.blocks_in_flight = 0;
+
+    options.compact          = 0;
+    options.max_line_length  = BIN2SRC_MAX_LINE_LENGTH;
+
+    memset(&stats, 0, sizeof(stats));
+
+    cache.dir_name = NULL;
+    cache.max_size = 1024UL * 1024UL * 1024UL; /* 1 GiB */
+    cache.hits     = 0;
+    cache.misses   = 0;
 
     /* ---------------------------------------------------------------------- */
     /* Arguments parsing */
@@ -748,15 +1444,83 @@ int main(int argc, char* argv[])
         int opt = -1;
         const char* OPT_STRING = "hvi:o:n:m:";
 
+        /* Long-only options, values are outside of the 'char' range */
+        enum {
+              OPT_VERIFY = 256
+            , OPT_WATCH
+            , OPT_DEBOUNCE
+            , OPT_CACHE
+            , OPT_CACHE_SIZE
+            , OPT_BASE
+            , OPT_BASE_NAME
+            , OPT_STATS
+            , OPT_WORD_SIZE
+            , OPT_ENDIAN
+            , OPT_COMPRESS
+            , OPT_BLOCK_SIZE
+            , OPT_THREADS
+            , OPT_IN_FLIGHT
+            , OPT_COMPACT
+            , OPT_LINE_LENGTH
+            , OPT_PACK
+            , OPT_TRACE
+            , OPT_PAGE_SIZE
+        };
+
+        const struct parg_option LONG_OPTIONS[] =
+        {
+              { "verify",      PARG_NOARG,  NULL, OPT_VERIFY      }
+            , { "watch",       PARG_REQARG, NULL, OPT_WATCH       }
+            , { "debounce",    PARG_REQARG, NULL, OPT_DEBOUNCE    }
+            , { "cache",       PARG_REQARG, NULL, OPT_CACHE       }
+            , { "cache-size",  PARG_REQARG, NULL, OPT_CACHE_SIZE  }
+            , { "base",        PARG_REQARG, NULL, OPT_BASE        }
+            , { "base-name",   PARG_REQARG, NULL, OPT_BASE_NAME   }
+            , { "stats",       PARG_NOARG,  NULL, OPT_STATS       }
+            , { "word-size",   PARG_REQARG, NULL, OPT_WORD_SIZE   }
+            , { "endian",      PARG_REQARG, NULL, OPT_ENDIAN      }
+            , { "compress",    PARG_NOARG,  NULL, OPT_COMPRESS    }
+            , { "block-size",  PARG_REQARG, NULL, OPT_BLOCK_SIZE  }
+            , { "threads",     PARG_REQARG, NULL, OPT_THREADS     }
+            , { "in-flight",   PARG_REQARG, NULL, OPT_IN_FLIGHT   }
+            , { "compact",     PARG_NOARG,  NULL, OPT_COMPACT     }
+            , { "line-length", PARG_REQARG, NULL, OPT_LINE_LENGTH }
+            , { "pack",        PARG_REQARG, NULL, OPT_PACK        }
+            , { "trace",       PARG_REQARG, NULL, OPT_TRACE       }
+            , { "page-size",   PARG_REQARG, NULL, OPT_PAGE_SIZE   }
+            , { NULL,         0,           NULL, 0              }
+        };
+
         struct parg_state ps;
         parg_init(&ps);
 
-        while ((opt = parg_getopt(&ps, argc, argv, OPT_STRING)) != -1)
+        while ((opt = parg_getopt_long(&ps, argc, argv, OPT_STRING, LONG_OPTIONS, NULL)) != -1)
         {
             switch (opt) {
 
             case 'h': { /* Help */
-                fprintf(stdout, "Usage: %s -i INPUT_FILE_NAME -o OUTPUT_FILE_NAME -n VARIABLE_NAME [-m MODE]\n", app_name);
+                fprintf(stdout, "Usage: %s -i INPUT_FILE_NAME -o OUTPUT_FILE_NAME -n VARIABLE_NAME [-m MODE] [OPTIONS]\n", app_name);
+                fprintf(stdout, "       %s --watch MANIFEST_FILE_NAME [--debounce MILLISECONDS] [OPTIONS]\n", app_name);
+                fprintf(stdout, "       %s --pack MANIFEST_FILE_NAME -o OUTPUT_FILE_NAME -n VARIABLE_NAME [--trace TRACE_FILE_NAME] [--page-size BYTES]\n", app_name);
+                fprintf(stdout, "  --verify      also generate 'verify_<name>_crc32c()' (for debug builds, i.e. without NDEBUG)\n");
+                fprintf(stdout, "  --watch       convert each manifest line 'INPUT OUTPUT NAME [MODE]', then regenerate on input changes\n");
+                fprintf(stdout, "  --debounce    wait for MILLISECONDS of quiet after a change before regenerating (default: 100)\n");
+                fprintf(stdout, "  --cache       reuse outputs from the shared, content-addressed cache DIR\n");
+                fprintf(stdout, "  --cache-size  cache size limit in MiB, least recently used outputs are evicted (default: 1024, 0 - unlimited)\n");
+                fprintf(stdout, "  --base        encode input as a delta against this file, embedded as --base-name in 'c_struct_func' mode\n");
+                fprintf(stdout, "  --base-name   variable name of the --base file\n");
+                fprintf(stdout, "  --stats       report throughput and read/format/write stages utilisation\n");
+                fprintf(stdout, "  --word-size   emit data as an array of 1, 2, 4 or 8 byte words (default: 1)\n");
+                fprintf(stdout, "  --endian      byte order of the target, for --word-size > 1: little or big (default: little)\n");
+                fprintf(stdout, "  --compress    compress data in blocks, read back by 'read_<name>(offset, length, dst)' in 'c_struct_func' mode\n");
+                fprintf(stdout, "  --block-size  --compress block size in KiB, the unit of random access (default: 64)\n");
+                fprintf(stdout, "  --threads     --compress threads (default: 0 - one per CPU), output doesn't depend on it\n");
+                fprintf(stdout, "  --in-flight   --compress blocks in memory at once, bounds memory use (default: 0 - two per thread)\n");
+                fprintf(stdout, "  --compact     emit decimal bytes without spaces, in long lines: ~3.6 characters per byte instead of 6.2 (see --stats)\n");
+                fprintf(stdout, "  --line-length --compact max line length (default: %i)\n", BIN2SRC_MAX_LINE_LENGTH);
+                fprintf(stdout, "  --pack        pack inputs of all manifest entries into one output (-o), as assets named by their variable names\n");
+                fprintf(stdout, "  --trace       --pack assets (or 'NAME OFFSET LENGTH' ranges) touched at startup: packed first, page-aligned\n");
+                fprintf(stdout, "  --page-size   --pack page size in bytes, a power of 2 (default: 4096)\n");
                 return EXIT_SUCCESS;
             } break;
 
@@ -787,16 +1551,151 @@ int main(int argc, char* argv[])
             } break;
 
             case 'm': { /* [M]ode (or output file format/style) */
-                mode = get_mode_from_str(ps.optarg);
-                if(mode == (Mode)-1)
+                mode = bin2src_mode_from_name(ps.optarg);
+                if(mode == (bin2src_mode)-1)
                 {
                     fprintf(stderr, "Error: undefined mode: %s\n", ps.optarg);
 
                     fprintf(stderr, "The list of known modes is:\n");
-                    print_modes(stderr);
+                    bin2src_print_modes(stderr);
+
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_VERIFY: { /* Generate debug checksum verification function */
+                options.with_verify = 1;
+            } break;
+
+            case OPT_WATCH: { /* Watch manifest inputs and regenerate on change */
+                const size_t arg_str_len = strlen(ps.optarg);
+                manifest_file_name = (char *) malloc(arg_str_len + 1);
+                strcpy(manifest_file_name, ps.optarg);
+            } break;
+
+            case OPT_CACHE: { /* Shared output cache directory */
+#if defined(BIN2SRC_POSIX)
+                cache.dir_name = ps.optarg;
+                mkdir(cache.dir_name, 0755); /* Fails harmlessly if it exists */
+#else
+                fprintf(stderr, "Error: output cache is not supported on this platform\n");
+                return EXIT_FAILURE;
+#endif
+            } break;
 
+            case OPT_CACHE_SIZE: { /* Shared output cache size limit */
+                size_t size_mib = 0;
+                if(parse_size(ps.optarg, &size_mib) != 0 || size_mib > ULONG_MAX / (1024UL * 1024UL))
+                {
+                    fprintf(stderr, "Error: invalid cache size: %s (expected MiB)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+                cache.max_size = (unsigned long)size_mib * 1024UL * 1024UL;
+            } break;
+
+            case OPT_BASE: { /* Delta encoding base file */
+                options.base_file_name = ps.optarg;
+            } break;
+
+            case OPT_BASE_NAME: { /* Delta encoding base variable name */
+                options.base_var_name = ps.optarg;
+            } break;
+
+            case OPT_STATS: { /* Report pipeline statistics */
+                options.stats = &stats;
+            } break;
+
+            case OPT_WORD_SIZE: { /* Array element size */
+                size_t word_size = 0;
+                if( (parse_size(ps.optarg, &word_size) != 0) ||
+                    ((word_size != 1) && (word_size != 2) && (word_size != 4) && (word_size != 8)) )
+                {
+                    fprintf(stderr, "Error: invalid word size: %s (expected 1, 2, 4 or 8)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+                options.word_size = word_size;
+            } break;
+
+            case OPT_ENDIAN: { /* Target byte order */
+                if(strcmp(ps.optarg, "little") == 0)
+                {
+                    options.big_endian = 0;
+                }
+                else if(strcmp(ps.optarg, "big") == 0)
+                {
+                    options.big_endian = 1;
+                }
+                else
+                {
+                    fprintf(stderr, "Error: invalid endian: %s (expected little or big)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_COMPRESS: { /* Seekable block compression */
+                compress = 1;
+            } break;
+
+            case OPT_BLOCK_SIZE: { /* Compression block size */
+                if( (parse_size(ps.optarg, &block_size_kib) != 0) || (block_size_kib == 0) || (block_size_kib > 64 * 1024) )
+                {
+                    fprintf(stderr, "Error: invalid block size: %s (expected 1 .. 65536 KiB)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_THREADS: { /* Compression threads */
+                if(parse_size(ps.optarg, &options.threads) != 0)
+                {
+                    fprintf(stderr, "Error: invalid threads count: %s (expected a number, 0 - one per CPU)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_IN_FLIGHT: { /* Compression memory bound */
+                if(parse_size(ps.optarg, &options.blocks_in_flight) != 0)
+                {
+                    fprintf(stderr, "Error: invalid blocks in flight count: %s (expected a number, 0 - two per thread)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_COMPACT: { /* Size-minimizing output format */
+                options.compact = 1;
+            } break;
+
+            case OPT_LINE_LENGTH: { /* Compact format line length limit */
+                if( (parse_size(ps.optarg, &options.max_line_length) != 0) || (options.max_line_length < BIN2SRC_MIN_LINE_LENGTH) )
+                {
+                    fprintf(stderr, "Error: invalid line length: %s (expected at least %i)\n", ps.optarg, BIN2SRC_MIN_LINE_LENGTH);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_PACK: { /* Pack manifest inputs into one output */
+                pack_manifest_file_name = ps.optarg;
+            } break;
+
+            case OPT_TRACE: { /* Startup access trace */
+                trace_file_name = ps.optarg;
+            } break;
+
+            case OPT_PAGE_SIZE: { /* Pack page size */
+                if( (parse_size(ps.optarg, &page_size) != 0) || (page_size < 16) || ((page_size & (page_size - 1)) != 0) )
+                {
+                    fprintf(stderr, "Error: invalid page size: %s (expected a power of 2, at least 16)\n", ps.optarg);
+                    return EXIT_FAILURE;
+                }
+            } break;
+
+            case OPT_DEBOUNCE: { /* Watch events debounce interval */
+                size_t interval_ms = 0;
+                if( (parse_size(ps.optarg, &interval_ms) != 0) || (interval_ms > INT_MAX) ) /* For poll() */
+                {
+                    fprintf(stderr, "Error: invalid debounce interval: %s (expected ms)\n", ps.optarg);
                     return EXIT_FAILURE;
                 }
+                debounce_ms = (int)interval_ms;
             } break;
 
             /* -------------------------------------------------------------- */
@@ -826,11 +1725,38 @@ int main(int argc, char* argv[])
 
     /* ---------------------------------------------------------------------- */
 
-    /* Arguments validation */
+    if(compress)
     {
-        if( (input_file_name == NULL) || (strlen(input_file_name) == 0) )
+        options.block_size = block_size_kib * 1024;
+    }
+
+    if(options.base_file_name != NULL)
+    {
+        if( (options.base_var_name == NULL) || (bin2src_check_var_name(options.base_var_name, strlen(options.base_var_name)) != 0) )
         {
-            fprintf(stderr, "Error: input file name is empty\n");
+            fprintf(stderr, "Error: invalid base var name %s\n", options.base_var_name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    /* Pack mode: all inputs come from the manifest, into one output */
+    if(pack_manifest_file_name != NULL)
+    {
+        Manifest manifest;
+        Trace    trace;
+        int result = 0;
+
+        if( (manifest_file_name != NULL) || (input_file_name != NULL) )
+        {
+            fprintf(stderr, "Error: --pack takes inputs from the manifest, without --watch and -i\n");
+            return EXIT_FAILURE;
+        }
+
+        if( options.with_verify || (options.base_file_name != NULL) || (options.word_size != 1) || compress )
+        {
+            fprintf(stderr, "Error: --pack doesn't support --verify, --base, --word-size and --compress\n");
             return EXIT_FAILURE;
         }
 
@@ -840,56 +1766,116 @@ int main(int argc, char* argv[])
             return EXIT_FAILURE;
         }
 
-        if( (var_name == NULL) || (is_valid_c_variable_name(var_name, strlen(var_name)) != 0) )
+        if( (var_name == NULL) || (bin2src_check_var_name(var_name, strlen(var_name)) != 0) )
         {
             fprintf(stderr, "Error: invalid var name %s\n", var_name);
             return EXIT_FAILURE;
         }
 
-        if( is_valid_mode(mode) != 0)
+        if(read_manifest(pack_manifest_file_name, &manifest) != 0)
         {
-            fprintf(stderr, "Error: invalid mode %i\n", mode);
             return EXIT_FAILURE;
         }
+
+        if(trace_file_name != NULL && read_trace(trace_file_name, &trace) != 0)
+        {
+            free_manifest(&manifest);
+            return EXIT_FAILURE;
+        }
+
+        result = pack_files(&manifest, (trace_file_name != NULL) ? &trace : NULL,
+                            output_file_name, var_name, page_size, &options);
+
+        if(options.stats != NULL)
+        {
+            bin2src_print_stats(stdout, options.stats);
+        }
+
+        if(trace_file_name != NULL) free_trace(&trace);
+        free_manifest(&manifest);
+        free(output_file_name);
+        free(var_name);
+
+        return (result != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
     }
 
-    /* ---------------------------------------------------------------------- */
+    if(trace_file_name != NULL)
+    {
+        fprintf(stderr, "Error: --trace requires --pack\n");
+        return EXIT_FAILURE;
+    }
 
-    if(read_file(input_file_name, &input_file_buffer, &input_file_size) == 0)
+    /* Watch mode: all conversions come from the manifest */
+    if(manifest_file_name != NULL)
     {
-        int result = -1;
+#if defined(__linux__)
+        Manifest manifest;
+
+        if(read_manifest(manifest_file_name, &manifest) != 0)
+        {
+            return EXIT_FAILURE;
+        }
 
-        switch (mode) {
-        case MODE_C_HEADER_SINGLE: {
-            result = write_C_header_single(output_file_name, var_name, input_file_buffer, input_file_size);
-        } break;
+        run_watch(&manifest, &options, &cache, debounce_ms); /* Returns only on error */
 
-        case MODE_C_HEADER_SOURCE_EXTERN: {
-            result = write_C_header_source_extern(output_file_name, var_name, input_file_buffer, input_file_size);
-        } break;
+        free_manifest(&manifest);
+        free(manifest_file_name);
+        return EXIT_FAILURE;
+#else
+        fprintf(stderr, "Error: watch mode is supported only on Linux (inotify)\n");
+        return EXIT_FAILURE;
+#endif
+    }
+
+    /* ---------------------------------------------------------------------- */
 
-        case MODE_C_HEADER_SOURCE_FUNCS: {
-            result = write_C_header_source_funcs(output_file_name, var_name, input_file_buffer, input_file_size);
-        } break;
+    /* Arguments validation */
+    {
+        if( (input_file_name == NULL) || (strlen(input_file_name) == 0) )
+        {
+            fprintf(stderr, "Error: input file name is empty\n");
+            return EXIT_FAILURE;
+        }
 
-        case MODE_C_HEADER_SOURCE_STRUCT_EXTERN: {
-            result = write_C_header_source_struct_extern(output_file_name, var_name, input_file_buffer, input_file_size);
-        } break;
+        if( (output_file_name == NULL) || (strlen(output_file_name) == 0) )
+        {
+            fprintf(stderr, "Error: output file name is empty\n");
+            return EXIT_FAILURE;
+        }
 
-        case MODE_C_HEADER_SOURCE_STRUCT_FUNC: {
-            result = write_C_header_source_struct_func(output_file_name, var_name, input_file_buffer, input_file_size);
-        } break;
+        if( (var_name == NULL) || (bin2src_check_var_name(var_name, strlen(var_name)) != 0) )
+        {
+            fprintf(stderr, "Error: invalid var name %s\n", var_name);
+            return EXIT_FAILURE;
+        }
 
-        default: { /* Unreachable: mode validated previously */ } break;
+        if( bin2src_mode_name(mode) == NULL )
+        {
+            fprintf(stderr, "Error: invalid mode %i\n", mode);
+            return EXIT_FAILURE;
         }
+    }
+
+    /* ---------------------------------------------------------------------- */
+
+    {
+        const int result = convert_file(input_file_name, output_file_name, var_name, mode, &options, &cache,
+                                        &input_file_buffer, &input_file_buffer_capacity);
 
         free(input_file_buffer);
 
-        /* ------------------------------------------------------------------ */
+        if(cache.dir_name != NULL)
+        {
+            fprintf(stdout, "Cache: %lu hit(s), %lu miss(es)\n", cache.hits, cache.misses);
+        }
+
+        if(options.stats != NULL)
+        {
+            bin2src_print_stats(stdout, options.stats);
+        }
 
         if(result != 0)
         {
-            fprintf(stderr, "Error during writing output into file\n");
             return EXIT_FAILURE;
         }
     }